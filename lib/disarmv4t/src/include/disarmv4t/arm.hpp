@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include "condition.hpp"
 #include "instructions/arm.hpp"
 #include "internal/common.hpp"
@@ -93,4 +94,66 @@ namespace disarmv4t::arm {
 
         return InstructionType::UD;
     }
+
+    namespace detail {
+        //  Index into the decode table, built from opcode bits [27:20] and [7:4]
+        constexpr uint32 decode_table_index(uint32 arm_opcode)
+        {
+            return ((arm_opcode >> 16) & 0xff0) | ((arm_opcode >> 4) & 0xf);
+        }
+
+        constexpr std::array<InstructionType, 4096> make_decode_table()
+        {
+            std::array<InstructionType, 4096> table {};
+            for (uint32 index = 0; index < table.size(); ++index) {
+                const uint32 key = ((index & 0xff0) << 16) | ((index & 0xf) << 4);
+
+                //  A few encodings also depend on the condition and bits [19:8],
+                //  so try the values those patterns look for. If the decoded type
+                //  differs between them, the full decoder has to be used instead.
+                const InstructionType type = decode(key);
+                const bool ambiguous = decode(key | 0xe00fff00) != type || decode(key | 0x000f0f00) != type
+                    || decode(key | 0x00000100) != type;
+                table[index] = ambiguous ? InstructionType::_end : type;
+            }
+            return table;
+        }
+
+        inline constexpr std::array<InstructionType, 4096> decode_table = make_decode_table();
+    } // namespace detail
+
+    /*
+     *  Returns the 4096-entry lookup table indexed by opcode bits [27:20] and [7:4].
+     *  Entries that can't be decoded from those bits alone hold InstructionType::_end.
+     */
+    constexpr std::array<InstructionType, 4096> const& decode_table()
+    {
+        return detail::decode_table;
+    }
+
+    /*
+     *  Equivalent to decode(), but resolves most opcodes with a single table lookup.
+     */
+    constexpr InstructionType decode_fast(uint32 arm_opcode)
+    {
+        const InstructionType type = decode_table()[detail::decode_table_index(arm_opcode)];
+        if (type != InstructionType::_end) {
+            return type;
+        }
+        return decode(arm_opcode);
+    }
+
+    static_assert(decode_fast(0xe12fff1e) == InstructionType::BX);
+    static_assert(decode_fast(0xe12fff3e) == decode(0xe12fff3e));
+    static_assert(decode_fast(0xe1a00000) == InstructionType::ALU);
+    static_assert(decode_fast(0xe0000291) == InstructionType::MUL);
+    static_assert(decode_fast(0xe0810392) == InstructionType::MLL);
+    static_assert(decode_fast(0xe1020091) == InstructionType::SWP);
+    static_assert(decode_fast(0xe1d000b0) == InstructionType::HDT);
+    static_assert(decode_fast(0xe19000b1) == InstructionType::HDT);
+    static_assert(decode_fast(0xe1a000b1) == decode(0xe1a000b1));
+    static_assert(decode_fast(0xe5901000) == InstructionType::SDT);
+    static_assert(decode_fast(0xe8bd8000) == InstructionType::BDT);
+    static_assert(decode_fast(0xeafffffe) == InstructionType::BBL);
+    static_assert(decode_fast(0xef000000) == InstructionType::SWI);
 } // namespace disarmv4t::arm
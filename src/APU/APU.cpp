@@ -6,6 +6,7 @@
 #include <vector>
 #include "Bus/Common/MemoryLayout.hpp"
 #include "CPU/ARM7TDMI.hpp"
+#include "Emulator/Scheduler.hpp"
 #include "Emulator/GaBber.hpp"
 
 APU::APU(GaBber& emu)
@@ -82,17 +83,20 @@ void APU::initialize_platform() {
 	SDL_PauseAudioDevice(m_device, 0);
 }
 
-void APU::cycle() {
+void APU::schedule_events(uint64 now) {
+	scheduler().schedule_at(EventType::APUSample, now + cycles_per_sample);
+}
+
+void APU::on_sample(uint64 timestamp) {
 	//  "The PSG channels 1-4 are internally generated at 262.144kHz"
-	//  One internal sample generated every 64 CPU cycles (main clock 16MHz)
-	m_cycles++;
-	m_square1.tick();
-	m_square2.tick();
-	m_wave.tick();
-	m_noise.tick();
-
-	if((m_cycles % 64) != 0)
-		return;
+	//  The channels are advanced a whole sample period at a time, every length,
+	//  envelope and sweep step is a multiple of it
+	m_cycles += cycles_per_sample;
+	m_square1.tick(cycles_per_sample);
+	m_square2.tick(cycles_per_sample);
+	m_wave.tick(cycles_per_sample);
+	m_noise.tick(cycles_per_sample);
+	schedule_events(timestamp);
 
 	int16 ch1 = m_square1.generate_sample();
 	int16 ch2 = m_square2.generate_sample();
@@ -16,6 +16,8 @@ class APU : Module {
 	friend class Sound2CtlL;
 	friend class Sound1CtlH;
 	static constexpr const unsigned psg_sample_rate = 262144;
+	//  One internal sample generated every 64 CPU cycles (main clock 16MHz)
+	static constexpr const unsigned cycles_per_sample = 64;
 	static constexpr const unsigned output_sample_rate = 48000;
 	static constexpr const double requested_latency = 0.02;//  in seconds
 
@@ -42,7 +44,8 @@ class APU : Module {
 public:
 	APU(GaBber&);
 	void initialize_platform();
-	void cycle();
+	void schedule_events(uint64 now);
+	void on_sample(uint64 timestamp);
 
 	std::array<float, psg_sample_count> const& internal_samples() const { return m_internal_samples; }
 
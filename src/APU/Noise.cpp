@@ -3,15 +3,16 @@
 #include "Bus/IO/IOContainer.hpp"
 #include "Bus/IO/Sound.hpp"
 
-void Noise::tick() {
-	m_cycles++;
+void Noise::tick(unsigned cycles) {
+	m_cycles += cycles;
 
 	if(m_rate_counter != 0) {
-		--m_rate_counter;
-		if(m_rate_counter == 0) {
+		while(cycles >= m_rate_counter) {
+			cycles -= m_rate_counter;
 			advance_state();
 			reload_rate();
 		}
+		m_rate_counter -= cycles;
 	}
 
 	if((m_cycles % 65536 == 0) && m_length_counter != 0) {
@@ -23,7 +23,7 @@ public:
 	    : Module(emu) {}
 
 	bool running() const { return m_running; }
-	void tick();
+	void tick(unsigned cycles);
 	int16 generate_sample() const;
 	void trigger();
 	void reload_envelope();
@@ -2,11 +2,11 @@
 #include "Bus/IO/IOContainer.hpp"
 #include "Bus/IO/Sound.hpp"
 
-void SquareSweep::tick() {
-	m_cycles++;
+void SquareSweep::tick(unsigned cycles) {
+	m_cycles += cycles;
 
 	//  One sample every 64 ticks
-	if((m_cycles % 64 == 0) && m_frequency_counter != 0) {
+	if(m_frequency_counter != 0) {
 		m_frequency_counter--;
 		if(m_frequency_counter == 0) {
 			reload_frequency();
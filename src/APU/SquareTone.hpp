@@ -27,6 +27,6 @@ public:
 	void reload_envelope();
 	bool running() const { return m_running; }
 	void trigger();
-	void tick();
+	void tick(unsigned cycles);
 	int16 generate_sample();
 };
\ No newline at end of file
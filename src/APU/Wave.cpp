@@ -1,8 +1,8 @@
 #include "Wave.hpp"
 #include "Bus/IO/IOContainer.hpp"
 
-void Wave::tick() {
-	m_cycles++;
+void Wave::tick(unsigned cycles) {
+	m_cycles += cycles;
 
 	if(!m_running) {
 		return;
@@ -15,21 +15,22 @@ void Wave::tick() {
 		}
 	}
 
-	if(m_rate_cycles != 0) {
-		m_rate_cycles--;
-		return;
-	}
+	//  A digit is consumed on the cycle after the counter runs out
+	while(cycles > m_rate_cycles) {
+		cycles -= m_rate_cycles + 1;
 
-	//  Reload the cycle counter with the amount of CPU cycles
-	//  for the current sample rate
-	reload_frequency();
+		//  Reload the cycle counter with the amount of CPU cycles
+		//  for the current sample rate
+		reload_frequency();
 
-	//  Consume 1 digit
-	if(io().ch3ctlL->dimension) {
-		m_current_digit = (m_current_digit + 1) % 64;
-	} else {
-		m_current_digit = (m_current_digit + 1) % 32;
+		//  Consume 1 digit
+		if(io().ch3ctlL->dimension) {
+			m_current_digit = (m_current_digit + 1) % 64;
+		} else {
+			m_current_digit = (m_current_digit + 1) % 32;
+		}
 	}
+	m_rate_cycles -= cycles;
 }
 
 int16 Wave::generate_sample() {
@@ -17,7 +17,7 @@ public:
 	void pause() { m_running = false; }
 	void resume() { m_running = true; }
 
-	void tick();
+	void tick(unsigned cycles);
 	int16 generate_sample();
 	void trigger();
 	void reload_length();
@@ -1,9 +1,42 @@
 #include "Bus/BIOS.hpp"
 #include <cstring>
+#include <utility>
 
 void BIOS::from_vec(std::vector<uint8> const& vec) {
 	assert(vec.size() == 0x4000);
 	std::memcpy(&m_bios.array()[0], &vec[0], 0x4000);
+	m_hle_stub = false;
+}
+
+/*
+ *  Minimal BIOS used when booting without a BIOS image. Only the exception
+ *  vectors are provided, SWIs must be handled by the HLE layer.
+ *  Unimplemented SWIs stop the emulator, as the stub would silently
+ *  return from them.
+ */
+void BIOS::load_hle_stub() {
+	static constexpr std::pair<uint32, uint32> stub[] = {
+		//  SWI: movs pc, lr
+		{ 0x08, 0xE1B0F00E },
+		//  IRQ: stmfd sp!, {r0-r3, r12, lr}
+		{ 0x18, 0xE92D500F },
+		//  mov r0, #0x04000000
+		{ 0x1C, 0xE3A00301 },
+		//  add lr, pc, #0
+		{ 0x20, 0xE28FE000 },
+		//  ldr pc, [r0, #-4]
+		{ 0x24, 0xE510F004 },
+		//  ldmfd sp!, {r0-r3, r12, lr}
+		{ 0x28, 0xE8BD500F },
+		//  subs pc, lr, #4
+		{ 0x2C, 0xE25EF004 },
+	};
+
+	m_bios.array().fill(0);
+	for(auto [offset, opcode] : stub) {
+		std::memcpy(&m_bios.array()[offset], &opcode, sizeof(opcode));
+	}
+	m_hle_stub = true;
 }
 
 uint8 BIOS::read8(uint32 offset) {
@@ -36,6 +69,10 @@ void BIOS::write16(uint32, uint16) {}
 
 void BIOS::write32(uint32, uint32) {}
 
+HostMapping BIOS::host_mapping(uint32) {
+	return { &m_bios.array()[0], 0x3fffu, HostRead };
+}
+
 void BIOS::reload() {
 	BusDevice::reload();
 }
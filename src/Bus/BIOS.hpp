@@ -6,12 +6,15 @@
 
 class BIOS final : public BusDevice {
 	ReaderArray<0x4000> m_bios;
+	bool m_hle_stub { false };
 public:
 	BIOS(GaBber& emu)
 	    : BusDevice(emu, 0x00000000, 0x00004000)
 	    , m_bios() {}
 
 	void from_vec(std::vector<uint8> const& vec);
+	void load_hle_stub();
+	bool is_hle_stub() const { return m_hle_stub; }
 
 	uint8 read8(uint32 offset) override;
 	uint16 read16(uint32 offset) override;
@@ -21,6 +24,8 @@ public:
 	void write16(uint32, uint16) override;
 	void write32(uint32, uint32) override;
 
+	HostMapping host_mapping(uint32 offset) override;
+
 	void reload() override;
 
 	unsigned int waitcycles32() const override { return 1; }
@@ -7,3 +7,8 @@ BusDevice::BusDevice(GaBber& emu, uint32 start, uint32 end) noexcept
     , m_end(end) {
 	bus().register_device(*this);
 }
+
+BusDevice::BusDevice(GaBber& emu, uint32 start, uint32 end, DetachedDevice) noexcept
+    : Module(emu)
+    , m_start(start)
+    , m_end(end) {}
@@ -2,11 +2,40 @@
 #include "Emulator/Module.hpp"
 #include "Emulator/StdTypes.hpp"
 
+class WriteTracker;
+
+enum HostAccess {
+	HostRead = 0x01,
+	HostWrite = 0x02,
+	HostWriteByte = 0x04
+};
+
+/*
+ *  Host memory backing a range of the bus. An access to a mapped bus address
+ *  resolves to base[address & mask], without going through the device.
+ *  Writable memory that may contain code, or that the device derives other
+ *  state from, also provides a write tracker, which has to be notified of
+ *  every write to the memory.
+ */
+struct HostMapping {
+	uint8* base { nullptr };
+	uint32 mask { 0 };
+	unsigned access { 0 };
+	WriteTracker* tracker { nullptr };
+};
+
+/*
+ *  Constructs a device that is not registered on the bus, such as a copy of
+ *  a device kept for another thread.
+ */
+struct DetachedDevice {};
+
 class BusDevice : public Module {
 	uint32 m_start;
 	uint32 m_end;
 public:
 	BusDevice(GaBber& emu, uint32 start, uint32 end) noexcept;
+	BusDevice(GaBber& emu, uint32 start, uint32 end, DetachedDevice) noexcept;
 
 	virtual ~BusDevice() = default;
 
@@ -22,10 +51,17 @@ public:
 	virtual void write16(uint32 offset, uint16 value) = 0;
 	virtual void write8(uint32 offset, uint8 value) = 0;
 
+	/*
+	 *  Returns the host memory backing the bus page at the given offset, if the
+	 *  device can be accessed directly. Devices with side effects on access
+	 *  should not override this.
+	 */
+	virtual HostMapping host_mapping(uint32) { return {}; }
+
 	uint32 start() const { return m_start; }
 	uint32 size() const { return m_end - m_start; }
 	uint32 end() const { return m_end; }
 	bool contains(uint32 addr) const { return addr >= start() && addr < end(); }
 
 	virtual void reload() {}
-};
\ No newline at end of file
+};
@@ -1,7 +1,9 @@
 #include "BusInterface.hpp"
+#include <algorithm>
 #include <iostream>
 #include "Bus/IO/IOContainer.hpp"
 #include "BusDevice.hpp"
+#include "CPU/ARM7TDMI.hpp"
 #include "Debugger/Debugger.hpp"
 #include "Emulator/GaBber.hpp"
 
@@ -30,9 +32,115 @@ bool BusInterface::register_device(BusDevice& dev) {
 	log("Register device {}, {:08x}-{:08x}\n", (void*)&dev, dev.start(), dev.end());
 	m_devices.push_back(&dev);
 	std::sort(m_devices.begin(), m_devices.end(), [](BusDevice*& a, BusDevice*& b) { return a->start() < b->start(); });
+
+	//  I/O registers are additionally indexed by byte, so that accesses spanning
+	//  multiple registers can be resolved without searching the device list
+	const uint32 io_first = std::max(dev.start(), io_start);
+	const uint32 io_last = std::min(dev.end(), io_start + io_size);
+	for(uint32 address = io_first; address < io_last; ++address) {
+		m_io_registers[address - io_start] = &dev;
+	}
+
+	//  Pages owned entirely by this device are dispatched to it directly, any
+	//  page that ends up with more than one device falls back to a device scan
+	const uint32 first_page = dev.start() >> page_bits;
+	const uint32 last_page = (std::min(dev.end(), address_space_end) + page_size - 1) >> page_bits;
+	for(uint32 page = first_page; page < last_page; ++page) {
+		auto& entry = m_pages[page];
+		const uint32 page_start = page << page_bits;
+		const bool covers_page = dev.start() <= page_start && dev.end() >= page_start + page_size;
+
+		if(entry.shared || entry.device || !covers_page) {
+			entry.device = nullptr;
+			entry.shared = true;
+		} else {
+			entry.device = &dev;
+		}
+	}
 	return false;
 }
 
+/*
+ *  Maps pages owned by a single device directly to the host memory backing them.
+ *  This must be called whenever a device changes its backing storage.
+ */
+void BusInterface::remap() {
+	for(uint32 page = 0; page < m_pages.size(); ++page) {
+		auto& entry = m_pages[page];
+		entry.host = {};
+		if(entry.device) {
+			entry.host = entry.device->host_mapping((page << page_bits) - entry.device->start());
+		}
+	}
+	cpu().invalidate_fetch_window();
+}
+
+/*
+ *  Splits an access to the I/O region into the largest aligned chunks that
+ *  fit in each register it touches, lowest address first. Unmapped bytes
+ *  read as 0xFF and ignore writes.
+ */
+static unsigned io_chunk_size(BusDevice const& dev, uint32 address, unsigned remaining) {
+	const uint32 available = std::min<uint32>(dev.end() - address, remaining);
+	unsigned chunk = available >= 4 ? 4 : (available >= 2 ? 2 : 1);
+	while(address % chunk != 0) {
+		chunk >>= 1u;
+	}
+	return chunk;
+}
+
+template<typename T>
+T BusInterface::io_read(uint32 address) {
+	T value = 0;
+	for(unsigned i = 0; i < sizeof(T);) {
+		const uint32 current = address + i;
+		auto* dev = m_io_registers[current - io_start];
+		if(!dev) {
+			this->log("Undefined byte read from {:08x}", current);
+			debugger().on_undefined_access(current);
+			value |= static_cast<T>(0xFFu) << (i * 8);
+			i += 1;
+			continue;
+		}
+
+		const unsigned chunk = io_chunk_size(*dev, current, sizeof(T) - i);
+		const uint32 offset = current - dev->start();
+		uint32 part;
+		switch(chunk) {
+			case 4: part = dev->read32(offset); break;
+			case 2: part = dev->read16(offset); break;
+			default: part = dev->read8(offset); break;
+		}
+		value |= static_cast<T>(part) << (i * 8);
+		i += chunk;
+	}
+	return value;
+}
+
+template<typename T>
+void BusInterface::io_write(uint32 address, T value) {
+	for(unsigned i = 0; i < sizeof(T);) {
+		const uint32 current = address + i;
+		auto* dev = m_io_registers[current - io_start];
+		if(!dev) {
+			log("Undefined byte write to {:08x}, byte: {:02x}", current, (value >> (i * 8)) & 0xFFu);
+			debugger().on_undefined_access(current);
+			i += 1;
+			continue;
+		}
+
+		const unsigned chunk = io_chunk_size(*dev, current, sizeof(T) - i);
+		const uint32 offset = current - dev->start();
+		const uint32 part = static_cast<uint32>(value) >> (i * 8);
+		switch(chunk) {
+			case 4: dev->write32(offset, part); break;
+			case 2: dev->write16(offset, part & 0xFFFFu); break;
+			default: dev->write8(offset, part & 0xFFu); break;
+		}
+		i += chunk;
+	}
+}
+
 uint32 ensure_align(uint32 address, uint8 alignment) {
 	uint32 ret = address;
 	if(address % alignment != 0) {
@@ -49,6 +157,13 @@ uint32 ensure_align(uint32 address, uint8 alignment) {
 uint32 BusInterface::read32(uint32 address) {
 	address = ensure_align(address, 4);
 
+	if(auto* host = host_pointer<uint32>(address, HostRead)) {
+		return *host;
+	}
+	if(is_io(address)) {
+		return io_read<uint32>(address);
+	}
+
 	auto dev = find_device(address, 4);
 	if(!dev) {
 		const uint16 lower = read16(address);
@@ -56,13 +171,20 @@ uint32 BusInterface::read32(uint32 address) {
 		return (static_cast<uint32>(higher) << 16u) | static_cast<uint32>(lower);
 	}
 
-	m_last_wait_cycles = dev->waitcycles32();
 	return dev->read32(address - dev->start());
 }
 
 void BusInterface::write32(uint32 address, uint32 value) {
 	address = ensure_align(address, 4);
 
+	if(host_write<uint32>(address, value, HostWrite)) {
+		return;
+	}
+	if(is_io(address)) {
+		io_write<uint32>(address, value);
+		return;
+	}
+
 	auto dev = find_device(address, 4);
 	if(!dev) {
 		write16(address, value & 0xFFFFu);
@@ -70,13 +192,19 @@ void BusInterface::write32(uint32 address, uint32 value) {
 		return;
 	}
 
-	m_last_wait_cycles = dev->waitcycles32();
 	dev->write32(address - dev->start(), value);
 }
 
 uint16 BusInterface::read16(uint32 address) {
 	address = ensure_align(address, 2);
 
+	if(auto* host = host_pointer<uint16>(address, HostRead)) {
+		return *host;
+	}
+	if(is_io(address)) {
+		return io_read<uint16>(address);
+	}
+
 	auto dev = find_device(address, 2);
 	if(!dev) {
 		const uint8 lower = read8(address);
@@ -84,13 +212,20 @@ uint16 BusInterface::read16(uint32 address) {
 		return (static_cast<uint16>(higher) << 8u) | static_cast<uint16>(lower);
 	}
 
-	m_last_wait_cycles = dev->waitcycles16();
 	return dev->read16(address - dev->start());
 }
 
 void BusInterface::write16(uint32 address, uint16 value) {
 	address = ensure_align(address, 2);
 
+	if(host_write<uint16>(address, value, HostWrite)) {
+		return;
+	}
+	if(is_io(address)) {
+		io_write<uint16>(address, value);
+		return;
+	}
+
 	auto dev = find_device(address, 2);
 	if(!dev) {
 		write8(address, value & 0xFFu);
@@ -98,11 +233,17 @@ void BusInterface::write16(uint32 address, uint16 value) {
 		return;
 	}
 
-	m_last_wait_cycles = dev->waitcycles16();
 	dev->write16(address - dev->start(), value);
 }
 
 uint8 BusInterface::read8(uint32 address) {
+	if(auto* host = host_pointer<uint8>(address, HostRead)) {
+		return *host;
+	}
+	if(is_io(address)) {
+		return io_read<uint8>(address);
+	}
+
 	auto* dev = find_device(address, 1);
 	if(!dev) {
 		this->log("Undefined byte read from {:08x}", address);
@@ -110,11 +251,18 @@ uint8 BusInterface::read8(uint32 address) {
 		return 0xFF;
 	}
 
-	m_last_wait_cycles = dev->waitcycles8();
 	return dev->read8(address - dev->start());
 }
 
 void BusInterface::write8(uint32 address, uint8 value) {
+	if(host_write<uint8>(address, value, HostWriteByte)) {
+		return;
+	}
+	if(is_io(address)) {
+		io_write<uint8>(address, value);
+		return;
+	}
+
 	auto* dev = find_device(address, 1);
 	if(!dev) {
 		log("Undefined byte write to {:08x}, byte: {:02x}", address, value);
@@ -122,11 +270,21 @@ void BusInterface::write8(uint32 address, uint8 value) {
 		return;
 	}
 
-	m_last_wait_cycles = dev->waitcycles8();
 	dev->write8(address - dev->start(), value);
 }
 
 BusDevice* BusInterface::find_device(uint32 address, size_t size) {
+	auto const* page = page_for(address);
+	if(page && !page->shared) {
+		//  Accesses never cross a page boundary, as they are always aligned
+		return page->device;
+	}
+
+	if(is_io(address)) {
+		auto* dev = m_io_registers[address - io_start];
+		return dev && dev->contains(address + size - 1) ? dev : nullptr;
+	}
+
 	static BusDevice* cache { nullptr };
 	if(cache && cache->contains(address) && cache->contains(address + size - 1)) {
 		return cache;
@@ -162,124 +320,46 @@ void BusInterface::reload() {
 	for(auto& dev : m_devices) {
 		dev->reload();
 	}
+	remap();
+	rebuild_wait_table();
 }
 
-unsigned BusInterface::waits32(uint32 address, AccessType type) {
-	switch(region_from_address(address)) {
-		case Region::BIOS:
-		case Region::IWRAM:
-		case Region::IO:
-		case Region::OAM: {
-			return 1;
-		}
-		case Region::WRAM: {
-			//  FIXME: TODO
-			return 6;
-		}
-		case Region::VRAM:
-		case Region::PAL: {
-			return 2;
-		}
-		case Region::PAKROM0: {
-			return waits16(address, type) + waits16(address + 2, AccessType::Seq);
-		}
-		case Region::PAKROM1: {
-			return waits16(address, type) + waits16(address + 2, AccessType::Seq);
-		}
-		case Region::PAKROM2: {
-			return waits16(address, type) + waits16(address + 2, AccessType::Seq);
-		}
-		case Region::PAKSRAM: {
-			return io().waitctl.sram_wait();
-		}
-		default: ASSERT_NOT_REACHED();
-	}
-}
-
-unsigned BusInterface::waits16(uint32 address, AccessType type) {
-	switch(region_from_address(address)) {
-		case Region::BIOS:
-		case Region::IWRAM:
-		case Region::IO:
-		case Region::OAM: {
-			return 1;
-		}
-		case Region::WRAM: {
-			//  FIXME: TODO
-			return 3;
-		}
-		case Region::VRAM:
-		case Region::PAL: {
-			return 1;
-		}
-		case Region::PAKROM0: {
-			if((address % 128 * kB) == 0) {
-				type = AccessType::NonSeq;
-			}
-			return type == AccessType::Seq ? io().waitctl.wait0_sequential() + 1
-			                               : io().waitctl.wait0_nonsequential() + 1;
-		}
-		case Region::PAKROM1: {
-			if((address % 128 * kB) == 0) {
-				type = AccessType::NonSeq;
-			}
-			return type == AccessType::Seq ? io().waitctl.wait1_sequential() + 1
-			                               : io().waitctl.wait1_nonsequential() + 1;
-		}
-		case Region::PAKROM2: {
-			if((address % 128 * kB) == 0) {
-				type = AccessType::NonSeq;
-			}
-			return type == AccessType::Seq ? io().waitctl.wait2_sequential() + 1
-			                               : io().waitctl.wait2_nonsequential() + 1;
-		}
-		case Region::PAKSRAM: {
-			return io().waitctl.sram_wait() + 1;
-		}
-		default: ASSERT_NOT_REACHED();
-	}
-}
-
-unsigned BusInterface::waits8(uint32 address, AccessType type) {
-	switch(region_from_address(address)) {
-		case Region::BIOS:
-		case Region::IWRAM:
-		case Region::IO:
-		case Region::OAM: {
-			return 1;
-		}
-		case Region::WRAM: {
-			//  FIXME: TODO
-			return 3;
-		}
-		case Region::VRAM:
-		case Region::PAL: {
-			return 1;
-		}
-		case Region::PAKROM0: {
-			if((address % 128 * kB) == 0) {
-				type = AccessType::NonSeq;
-			}
-			return type == AccessType::Seq ? io().waitctl.wait0_sequential() + 1
-			                               : io().waitctl.wait0_nonsequential() + 1;
-		}
-		case Region::PAKROM1: {
-			if((address % 128 * kB) == 0) {
-				type = AccessType::NonSeq;
-			}
-			return type == AccessType::Seq ? io().waitctl.wait1_sequential() + 1
-			                               : io().waitctl.wait1_nonsequential() + 1;
-		}
-		case Region::PAKROM2: {
-			if((address % 128 * kB) == 0) {
-				type = AccessType::NonSeq;
-			}
-			return type == AccessType::Seq ? io().waitctl.wait2_sequential() + 1
-			                               : io().waitctl.wait2_nonsequential() + 1;
-		}
-		case Region::PAKSRAM: {
-			return io().waitctl.sram_wait() + 1;
-		}
-		default: ASSERT_NOT_REACHED();
+void BusInterface::rebuild_wait_table() {
+	auto const& waitctl = io().waitctl;
+	++m_wait_generation;
+
+	for(unsigned type = 0; type < 2; ++type) {
+		const bool sequential = type == static_cast<unsigned>(AccessType::Seq);
+		auto set_region = [&](unsigned region, unsigned waits16, unsigned waits32) {
+			m_wait_table[region][0][type] = waits16;
+			m_wait_table[region][1][type] = waits16;
+			m_wait_table[region][2][type] = waits32;
+		};
+
+		//  BIOS, WRAM, IWRAM, I/O, palette, VRAM, OAM
+		//  FIXME: TODO: WRAM waitstates
+		set_region(0x0, 1, 1);
+		set_region(0x1, 1, 1);
+		set_region(0x2, 3, 6);
+		set_region(0x3, 1, 1);
+		set_region(0x4, 1, 1);
+		set_region(0x5, 1, 2);
+		set_region(0x6, 1, 2);
+		set_region(0x7, 1, 1);
+
+		//  32-bit game pak accesses are split into two 16-bit accesses, the
+		//  second one of which is always sequential
+		const unsigned rom0 = (sequential ? waitctl.wait0_sequential() : waitctl.wait0_nonsequential()) + 1;
+		const unsigned rom1 = (sequential ? waitctl.wait1_sequential() : waitctl.wait1_nonsequential()) + 1;
+		const unsigned rom2 = (sequential ? waitctl.wait2_sequential() : waitctl.wait2_nonsequential()) + 1;
+		set_region(0x8, rom0, rom0 + waitctl.wait0_sequential() + 1);
+		set_region(0x9, rom0, rom0 + waitctl.wait0_sequential() + 1);
+		set_region(0xa, rom1, rom1 + waitctl.wait1_sequential() + 1);
+		set_region(0xb, rom1, rom1 + waitctl.wait1_sequential() + 1);
+		set_region(0xc, rom2, rom2 + waitctl.wait2_sequential() + 1);
+		set_region(0xd, rom2, rom2 + waitctl.wait2_sequential() + 1);
+
+		set_region(0xe, waitctl.sram_wait() + 1, waitctl.sram_wait());
+		set_region(0xf, waitctl.sram_wait() + 1, waitctl.sram_wait());
 	}
 }
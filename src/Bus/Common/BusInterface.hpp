@@ -1,6 +1,10 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <fmt/format.h>
 #include <vector>
+#include "Bus/Common/BusDevice.hpp"
+#include "Bus/Common/WriteTracker.hpp"
 #include "Emulator/Module.hpp"
 #include "Emulator/StdTypes.hpp"
 
@@ -9,57 +13,94 @@ enum class AccessType {
 	Seq
 };
 
-class BusDevice;
-
 class BusInterface : Module {
-	enum class Region {
-		BIOS,
-		IWRAM,
-		IO,
-		OAM,
-		WRAM,
-		PAL,
-		VRAM,
-		PAKROM0,
-		PAKROM1,
-		PAKROM2,
-		PAKSRAM
-	};
+public:
+	static constexpr const unsigned page_bits = 14;
+	static constexpr const uint32 page_size = 1u << page_bits;
+private:
+	/*
+	 *  Access cycles for each 16MiB region of the address space, indexed by
+	 *  [region][log2 of the access width][AccessType]. Game pak entries depend
+	 *  on WAITCNT, so the table is rebuilt whenever it is written.
+	 */
+	std::array<std::array<std::array<uint8, 2>, 3>, 16> m_wait_table {};
+	//  Bumped on every rebuild of the wait table
+	unsigned m_wait_generation { 0 };
+
+	static constexpr unsigned wait_region(uint32 address) {
+		//  Everything past the game pak SRAM is treated as SRAM
+		return (address >> 24u) < 0xf ? (address >> 24u) : 0xf;
+	}
 
-	static constexpr Region region_from_address(uint32 address) {
-		if(address < 0x02000000) {
-			return Region::BIOS;
-		} else if(address < 0x03000000) {
-			return Region::WRAM;
-		} else if(address < 0x04000000) {
-			return Region::IWRAM;
-		} else if(address < 0x05000000) {
-			return Region::IO;
-		} else if(address < 0x06000000) {
-			return Region::PAL;
-		} else if(address < 0x07000000) {
-			return Region::VRAM;
-		} else if(address < 0x08000000) {
-			return Region::OAM;
-		} else if(address < 0x0a000000) {
-			return Region::PAKROM0;
-		} else if(address < 0x0c000000) {
-			return Region::PAKROM1;
-		} else if(address < 0x0e000000) {
-			return Region::PAKROM2;
-		} else {
-			return Region::PAKSRAM;
+	static constexpr unsigned wait_type(uint32 address, AccessType type) {
+		//  The first access in every 128KiB block of the game pak is non-sequential
+		if(type == AccessType::Seq && (address & 0x1ffffu) != 0) {
+			return static_cast<unsigned>(AccessType::Seq);
 		}
+		return static_cast<unsigned>(AccessType::NonSeq);
 	}
 
+	static constexpr const uint32 address_space_end = 0x10000000;
+
+	/*
+	 *  The 28-bit address space is split into 16KiB pages. A page either maps
+	 *  directly to host memory, belongs to exactly one device, or is shared
+	 *  between multiple devices (I/O) and has to be resolved by a device scan.
+	 */
+	struct Page {
+		BusDevice* device { nullptr };
+		bool shared { false };
+		HostMapping host {};
+	};
+
+	static constexpr const uint32 io_start = 0x04000000;
+	static constexpr const uint32 io_size = 0x400;
+
 	friend class BusDevice;
 	friend class TestHarness;
 
 	std::vector<BusDevice*> m_devices;
+	std::array<Page, (address_space_end >> page_bits)> m_pages {};
+	std::array<BusDevice*, io_size> m_io_registers {};
 	bool register_device(BusDevice&);
 
-	unsigned m_last_wait_cycles;
 	BusDevice* find_device(uint32 address, size_t size);
+
+	Page const* page_for(uint32 address) const {
+		if(address >= address_space_end) {
+			return nullptr;
+		}
+		return &m_pages[address >> page_bits];
+	}
+
+	static constexpr bool is_io(uint32 address) { return address - io_start < io_size; }
+
+	template<typename T>
+	T io_read(uint32 address);
+	template<typename T>
+	void io_write(uint32 address, T value);
+
+	template<typename T>
+	T* host_pointer(uint32 address, unsigned access) const {
+		auto const* page = page_for(address);
+		if(!page || !(page->host.access & access)) {
+			return nullptr;
+		}
+		return reinterpret_cast<T*>(page->host.base + (address & page->host.mask));
+	}
+
+	template<typename T>
+	bool host_write(uint32 address, T value, unsigned access) {
+		auto const* page = page_for(address);
+		if(!page || !(page->host.access & access)) {
+			return false;
+		}
+		*reinterpret_cast<T*>(page->host.base + (address & page->host.mask)) = value;
+		if(page->host.tracker) {
+			page->host.tracker->on_write(address, sizeof(T));
+		}
+		return true;
+	}
 public:
 	BusInterface(GaBber&);
 	template<typename... Args>
@@ -71,8 +112,6 @@ public:
 		fmt::print("\u001b[0m\n");
 	}
 
-	unsigned last_wait_cycles() const { return m_last_wait_cycles; }
-
 	uint32 read32(uint32 address);
 	uint16 read16(uint32 address);
 	uint8 read8(uint32 address);
@@ -85,10 +124,74 @@ public:
 	void poke(uint32 address, uint8 val);
 
 	void reload();
+	void remap();
+
+	/*
+	 *  Returns the host memory mapping of the page containing the given address,
+	 *  or nullptr if the page is not backed by host memory.
+	 */
+	HostMapping const* host_mapping(uint32 address) const {
+		auto const* page = page_for(address);
+		if(!page || !page->host.base) {
+			return nullptr;
+		}
+		return &page->host;
+	}
 
-	unsigned waits32(uint32 address, AccessType);
-	unsigned waits16(uint32 address, AccessType);
-	unsigned waits8(uint32 address, AccessType);
+	/*
+	 *  Host memory backing the bus from the given address up to the end of its
+	 *  page or mirror, but at most max_size bytes, used for bulk transfers.
+	 *  After writing to the span, the caller has to report the written bytes
+	 *  with host_written.
+	 */
+	struct HostSpan {
+		uint8* data { nullptr };
+		uint32 size { 0 };
+	};
+	HostSpan host_span(uint32 address, unsigned access, uint32 max_size = page_size) {
+		auto const* page = page_for(address);
+		if(!page || !(page->host.access & access)) {
+			return {};
+		}
+		const uint32 page_room = page_size - (address & (page_size - 1));
+		const uint32 mirror_room = page->host.mask + 1 - (address & page->host.mask);
+		const uint32 size = std::min({ page_room, mirror_room, max_size });
+		return { page->host.base + (address & page->host.mask), size };
+	}
+
+	void host_written(uint32 address, uint32 size) {
+		auto const* page = page_for(address);
+		if(page && page->host.tracker) {
+			page->host.tracker->on_write(address, size);
+		}
+	}
+
+	/*
+	 *  Registers that code was decoded from the given address, and returns the
+	 *  write generation that changes once that code is overwritten. Returns
+	 *  nullptr if writes to the address are not tracked. The returned
+	 *  generation covers CodeTracker::chunk_size aligned bytes.
+	 */
+	uint32 const* track_code(uint32 address) {
+		auto const* page = page_for(address);
+		if(!page || !page->host.tracker) {
+			return nullptr;
+		}
+		return page->host.tracker->mark_code(address);
+	}
+
+	void rebuild_wait_table();
+	unsigned wait_generation() const { return m_wait_generation; }
+
+	unsigned waits32(uint32 address, AccessType type) const {
+		return m_wait_table[wait_region(address)][2][wait_type(address, type)];
+	}
+	unsigned waits16(uint32 address, AccessType type) const {
+		return m_wait_table[wait_region(address)][1][wait_type(address, type)];
+	}
+	unsigned waits8(uint32 address, AccessType type) const {
+		return m_wait_table[wait_region(address)][0][wait_type(address, type)];
+	}
 
 	void debug();
 };
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "Bus/Common/MappedFile.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(std::string const& path) {
+	close();
+
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+
+	struct stat info {};
+	if(fstat(fd, &info) != 0 || info.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+
+	const auto size = static_cast<size_t>(info.st_size);
+	void* base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	//  The mapping stays valid after the descriptor is closed
+	::close(fd);
+	if(base == MAP_FAILED) {
+		return false;
+	}
+
+	//  The whole file is going to be accessed, start reading it in right away
+	madvise(base, size, MADV_WILLNEED);
+	m_base = static_cast<uint8*>(base);
+	m_size = size;
+	return true;
+}
+
+void MappedFile::close() {
+	if(m_base) {
+		munmap(m_base, m_size);
+	}
+	m_base = nullptr;
+	m_size = 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include "Emulator/StdTypes.hpp"
+
+/*
+ *  Read-only private memory mapping of a file. Pages are loaded on demand
+ *  and shared with the page cache, so the file is never copied in memory.
+ */
+class MappedFile {
+	uint8* m_base { nullptr };
+	size_t m_size { 0 };
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	bool open(std::string const& path);
+	void close();
+
+	bool is_valid() const { return m_base != nullptr; }
+	uint8 const* data() const { return m_base; }
+	size_t size() const { return m_size; }
+};
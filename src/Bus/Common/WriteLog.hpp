@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include "Bus/Common/BusDevice.hpp"
+#include "Emulator/StdTypes.hpp"
+
+/*
+ *  Writes to a device in the order they happened, so that they can be applied
+ *  to a detached copy of the device later on.
+ */
+class WriteLog {
+	struct Entry {
+		uint32 offset;
+		uint32 value;
+		//  Size of the write in bytes, 0 for a reload of the device
+		uint8 size;
+	};
+
+	std::vector<Entry> m_entries;
+public:
+	void record(uint32 offset, uint32 value, uint8 size) { m_entries.push_back({ offset, value, size }); }
+
+	void record_reload() { m_entries.push_back({ 0, 0, 0 }); }
+
+	void replay(BusDevice& device) const {
+		for(auto const& entry : m_entries) {
+			switch(entry.size) {
+				case 0: device.reload(); break;
+				case 1: device.write8(entry.offset, entry.value); break;
+				case 2: device.write16(entry.offset, entry.value); break;
+				default: device.write32(entry.offset, entry.value); break;
+			}
+		}
+	}
+
+	void clear() { m_entries.clear(); }
+
+	void swap(WriteLog& other) { m_entries.swap(other.m_entries); }
+};
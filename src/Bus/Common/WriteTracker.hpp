@@ -0,0 +1,89 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "Emulator/StdTypes.hpp"
+
+/*
+ *  Notified of writes that bypass a device and go straight to the host memory
+ *  it mapped onto the bus. Devices which keep state derived from their memory
+ *  implement this to stay up to date. The write has already happened when the
+ *  tracker is notified, and addresses are bus addresses.
+ */
+class WriteTracker {
+public:
+	virtual ~WriteTracker() = default;
+
+	virtual void on_write(uint32 address, uint32 size) = 0;
+
+	//  Whether the tracker can detect modified code, see CodeTracker
+	virtual bool tracks_code() const { return false; }
+
+	virtual uint32 const* mark_code(uint32) { return nullptr; }
+
+	//  One bit per chunk marked as holding code, see CodeTracker
+	virtual uint64 const* code_bitmap() const { return nullptr; }
+};
+
+/*
+ *  Tracks writes to memory that may contain code, in chunks of 256 bytes.
+ *  Decode caches mark the chunks they decoded code from and remember the
+ *  chunk's write generation; a write to a marked chunk bumps its generation,
+ *  which makes everything decoded from it stale, and unmarks it again.
+ *  Writes to chunks without code only cost a bit test.
+ */
+class CodeTracker final : public WriteTracker {
+	std::vector<uint32> m_generations;
+	std::vector<uint64> m_code;
+	//  Memory size minus one, the memory is mirrored over its part of the bus
+	uint32 m_mask;
+public:
+	static constexpr const unsigned chunk_bits = 8;
+	static constexpr const uint32 chunk_size = 1u << chunk_bits;
+
+	explicit CodeTracker(uint32 memory_size)
+	    : m_generations(memory_size >> chunk_bits)
+	    , m_code(((memory_size >> chunk_bits) + 63) / 64)
+	    , m_mask(memory_size - 1) {}
+
+	void on_write(uint32 address) {
+		const uint32 chunk = (address & m_mask) >> chunk_bits;
+		auto& word = m_code[chunk / 64];
+		const uint64 bit = 1ull << (chunk % 64);
+		if(word & bit) [[unlikely]] {
+			word &= ~bit;
+			++m_generations[chunk];
+		}
+	}
+
+	void on_write(uint32 address, uint32 size) override {
+		if(size == 0) {
+			return;
+		}
+		const uint32 offset = address & m_mask;
+		const uint32 last = std::min<uint32>(offset + size - 1, m_mask);
+		for(uint32 chunk = offset >> chunk_bits; chunk <= (last >> chunk_bits); ++chunk) {
+			on_write(chunk << chunk_bits);
+		}
+	}
+
+	bool tracks_code() const override { return true; }
+
+	/*
+	 *  Marks the chunk containing the given address as holding decoded code,
+	 *  and returns its write generation.
+	 */
+	uint32 const* mark_code(uint32 address) override {
+		const uint32 chunk = (address & m_mask) >> chunk_bits;
+		m_code[chunk / 64] |= 1ull << (chunk % 64);
+		return &m_generations[chunk];
+	}
+
+	uint64 const* code_bitmap() const override { return m_code.data(); }
+
+	void invalidate_all() {
+		for(auto& generation : m_generations) {
+			++generation;
+		}
+		std::fill(m_code.begin(), m_code.end(), 0);
+	}
+};
@@ -1,43 +1,110 @@
 #include "Bus/GamePak.hpp"
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <fmt/format.h>
+#include <fstream>
+#include <string_view>
+#include <sys/stat.h>
+#include <utility>
 #include "Bus/Cart/Flash.hpp"
 #include "Bus/Cart/SRAM.hpp"
 
-std::optional<BackupCartType> GamePak::autodetect_flash(std::vector<uint8> const& rom) {
-	const unsigned aligned_size = rom.size() & ~3u;
-	for(unsigned i = 0; i < aligned_size; i += 4) {
-		const uint32 value = *reinterpret_cast<uint32 const*>(&rom[i]);
-		//  'EEPR', 'SRAM', 'FLAS' in word form
-		if(value != 0x52504545 && value != 0x4d415253 && value != 0x53414c46) {
-			continue;
-		}
-		if(i + 10 > rom.size()) {
+/*
+ *  Backup libraries identify themselves with a word-aligned string in the ROM.
+ */
+static constexpr std::array<std::pair<std::string_view, BackupCartType>, 5> s_backup_strings { {
+	{ "EEPROM_V", BackupCartType::EEPROM },
+	{ "SRAM_V", BackupCartType::SRAM32K },
+	{ "FLASH_V", BackupCartType::FLASH64K },
+	{ "FLASH512_V", BackupCartType::FLASH64K },
+	{ "FLASH1M_V", BackupCartType::FLASH128K },
+} };
+
+std::vector<BackupCartType> GamePak::detect_backup_types(std::span<uint8 const> rom) {
+	//  All backup strings end in "_V", so a single search for the suffix finds
+	//  every one of them, in the order they appear in the ROM
+	std::vector<BackupCartType> found;
+	auto const* begin = rom.data();
+	auto const* end = begin + rom.size();
+	for(auto const* cursor = begin; cursor < end;) {
+		auto const* hit = static_cast<uint8 const*>(memmem(cursor, end - cursor, "_V", 2));
+		if(!hit) {
 			break;
 		}
 
-		const char* str_ptr = reinterpret_cast<const char*>(&rom[i]);
-		if(std::strncmp("EEPROM_V", str_ptr, 8) == 0) {
-			return { BackupCartType::EEPROM };
-		}
-		if(std::strncmp("SRAM_V", str_ptr, 6) == 0) {
-			return { BackupCartType::SRAM32K };
-		}
-		if(std::strncmp("FLASH_V", str_ptr, 7) == 0) {
-			return { BackupCartType::FLASH64K };
+		const size_t suffix = hit - begin;
+		for(auto const& [name, type] : s_backup_strings) {
+			const size_t length = name.size() - 2;
+			if(suffix < length || (suffix - length) % 4 != 0) {
+				continue;
+			}
+			if(std::memcmp(begin + suffix - length, name.data(), length) == 0) {
+				found.push_back(type);
+				break;
+			}
 		}
-		if(std::strncmp("FLASH512_V", str_ptr, 10) == 0) {
-			return { BackupCartType::FLASH64K };
+		cursor = hit + 1;
+	}
+
+	return found;
+}
+
+/*
+ *  Scanning a large ROM is not free, so the result is remembered in a file
+ *  next to it. The cache is keyed by the identity and modification time of
+ *  the ROM file, so any change to the file invalidates it without having to
+ *  read the whole ROM.
+ */
+static std::optional<uint64> backup_cache_key(std::string const& rom_path) {
+	struct stat info {};
+	if(stat(rom_path.c_str(), &info) != 0) {
+		return {};
+	}
+
+	uint64 hash = 0xcbf29ce484222325ull;
+	auto mix = [&hash](uint64 field) {
+		for(unsigned i = 0; i < 8; ++i) {
+			hash = (hash ^ ((field >> (i * 8)) & 0xFFu)) * 0x100000001b3ull;
 		}
-		if(std::strncmp("FLASH1M_V", str_ptr, 9) == 0) {
-			return { BackupCartType::FLASH128K };
+	};
+	mix(info.st_dev);
+	mix(info.st_ino);
+	mix(info.st_size);
+	mix(info.st_mtim.tv_sec);
+	mix(info.st_mtim.tv_nsec);
+	return hash;
+}
+
+std::optional<BackupCartType> GamePak::autodetect_flash(std::span<uint8 const> rom, std::string const& rom_path) {
+	//  Results without any backup string are stored as -1
+	const auto cache_path = rom_path + ".backup";
+	const auto key = backup_cache_key(rom_path);
+	std::ifstream cache_file { cache_path };
+	uint64 cached_key = 0;
+	int cached_type = -1;
+	if(key.has_value() && cache_file >> std::hex >> cached_key >> std::dec >> cached_type && cached_key == *key &&
+	   cached_type <= static_cast<int>(BackupCartType::FLASH128K)) {
+		if(cached_type < 0) {
+			return {};
 		}
+		return { static_cast<BackupCartType>(cached_type) };
 	}
 
-	return {};
+	const auto found = detect_backup_types(rom);
+	const int type = found.empty() ? -1 : static_cast<int>(found.front());
+	if(key.has_value()) {
+		std::ofstream { cache_path } << fmt::format("{:016x} {}\n", *key, type);
+	}
+
+	if(found.empty()) {
+		return {};
+	}
+	return { found.front() };
 }
-bool GamePak::load_pak(std::vector<uint8>&& rom_, std::vector<uint8>&& sram_) {
-	auto result = autodetect_flash(rom_);
+
+bool GamePak::load_pak(std::vector<uint8>&& sram_, std::string const& rom_path) {
+	auto result = autodetect_flash(rom.contents(), rom_path);
 	BackupCartType type;
 
 	if(!result.has_value()) {
@@ -71,7 +138,6 @@ bool GamePak::load_pak(std::vector<uint8>&& rom_, std::vector<uint8>&& sram_) {
 		}
 	}
 
-	rom.from_vec(std::move(rom_));
 	sram.set_cart(std::move(cart));
 
 	return true;
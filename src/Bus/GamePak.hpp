@@ -1,5 +1,7 @@
 #pragma once
 #include <optional>
+#include <span>
+#include <string>
 #include <vector>
 #include "Bus/ROM.hpp"
 #include "Bus/PakSRAM.hpp"
@@ -14,6 +16,8 @@ struct GamePak : Module {
 	    , rom(emu)
 	    , sram(emu) {}
 
-	static std::optional<BackupCartType> autodetect_flash(std::vector<uint8> const& rom);
-	bool load_pak(std::vector<uint8>&& rom_, std::vector<uint8>&& sram_);
+	static std::vector<BackupCartType> detect_backup_types(std::span<uint8 const> rom);
+	static std::optional<BackupCartType> autodetect_flash(std::span<uint8 const> rom, std::string const& rom_path);
+	//  Sets up the backup cart for the ROM, which has to be loaded from the given file beforehand
+	bool load_pak(std::vector<uint8>&& sram_, std::string const& rom_path);
 };
@@ -11,6 +11,12 @@ void OffsetReg<address>::on_write(uint16 val) {
 	this->m_register = val & 0b111111111;
 }
 
+template<unsigned int address>
+void AffineRefReg<address>::on_write(uint32 val) {
+	this->m_register = val & 0x0FFFFFFFu;
+	m_reload = true;
+}
+
 template<unsigned int x, unsigned int address>
 uint16 BGCNT<x, address>::on_read() {
 	return this->m_register;
@@ -39,6 +45,11 @@ template void OffsetReg<67108892u>::on_write(uint16);
 template uint16 OffsetReg<67108894u>::on_read();
 template void OffsetReg<67108894u>::on_write(uint16);
 
+template void AffineRefReg<67108904u>::on_write(uint32);
+template void AffineRefReg<67108908u>::on_write(uint32);
+template void AffineRefReg<67108920u>::on_write(uint32);
+template void AffineRefReg<67108924u>::on_write(uint32);
+
 template uint16 BGCNT<0, 67108872u>::on_read();
 template void BGCNT<0, 67108872u>::on_write(uint16);
 template uint16 BGCNT<1, 67108874u>::on_read();
@@ -2,6 +2,23 @@
 #include "Bus/Common/IOReg.hpp"
 #include "PPU.hpp"
 
+/*
+ *  Reference point of an affine background, as a signed 20.8 fixed-point
+ *  number. Writes make the PPU reload its internal reference point, which
+ *  otherwise advances every scanline.
+ */
+template<unsigned address>
+class AffineRefReg final : public IOReg32<address> {
+	void on_write(uint32 val) override;
+public:
+	AffineRefReg(GaBber& emu)
+	    : IOReg32<address>(emu) {}
+
+	bool m_reload { true };
+
+	int32 value() const { return static_cast<int32>(this->m_register << 4u) >> 4; }
+};
+
 template<unsigned n>
 struct __BGExtraVars {
 	__BGExtraVars(GaBber&) {}
@@ -22,8 +39,8 @@ struct __BGExtraVars<2> {
 	IOReg16<0x04000022> m_dmx;
 	IOReg16<0x04000024> m_dy;
 	IOReg16<0x04000026> m_dmy;
-	IOReg32<0x04000028> m_refx;
-	IOReg32<0x0400002C> m_refy;
+	AffineRefReg<0x04000028> m_refx;
+	AffineRefReg<0x0400002C> m_refy;
 };
 
 template<>
@@ -40,8 +57,8 @@ struct __BGExtraVars<3> {
 	IOReg16<0x04000032> m_dmx;
 	IOReg16<0x04000034> m_dy;
 	IOReg16<0x04000036> m_dmy;
-	IOReg32<0x04000038> m_refx;
-	IOReg32<0x0400003C> m_refy;
+	AffineRefReg<0x04000038> m_refx;
+	AffineRefReg<0x0400003C> m_refy;
 };
 
 template<unsigned address>
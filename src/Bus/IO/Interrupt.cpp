@@ -1,4 +1,5 @@
 #include "Interrupt.hpp"
+#include "Bus/Common/BusInterface.hpp"
 
 uint16 IE::on_read() {
 	return m_register & ~0xc000;
@@ -38,6 +39,7 @@ uint32 WaitControl::on_read() {
 
 void WaitControl::on_write(uint32 new_value) {
 	m_register = new_value & writeable_mask;
+	bus().rebuild_wait_table();
 }
 
 uint32 MemCtl::on_read() {
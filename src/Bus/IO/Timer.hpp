@@ -16,6 +16,7 @@ class TimerReload final : public IOReg16<0x04000100 + x * 4> {
 	uint16 m_reload { 0 };
 
 	void on_write(uint16 val) override { m_reload = val; }
+	uint16 on_read() override;
 public:
 	TimerReload(GaBber& emu)
 	    : IOReg16<67109120 + x * 4>(emu) {}
@@ -30,7 +31,7 @@ protected:
 	static constexpr const uint32 writeable_mask = 0xC3 | countup_mask;
 	static constexpr const uint32 readable_mask = writeable_mask;
 
-	void on_write(uint16 val) override { this->m_register = val & writeable_mask; }
+	void on_write(uint16 val) override;
 	uint16 on_read() override { return this->m_register & readable_mask; }
 public:
 	TimerCtl(GaBber& emu)
@@ -45,10 +46,11 @@ template<unsigned x>
 struct Timer {
 	static_assert(x < 4, "Invalid timer number");
 
-	unsigned m_timer_cycles { 0 };
+	//  While the timer runs, the counter register holds the counter value at
+	//  this timestamp, which is always on a prescaler tick
+	uint64 m_start { 0 };
 	TimerReload<x> m_reload_and_current;
 	TimerCtl<x> m_ctl;
-	bool m_previous_cycle_was_running { false };
 
 	Timer(GaBber& emu)
 	    : m_reload_and_current(emu)
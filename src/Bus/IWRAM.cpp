@@ -38,6 +38,7 @@ void IWRAM::write8(uint32 offset, uint8 value) {
 		return;
 	}
 	m_iwram.write8(offset, value);
+	m_writes.on_write(offset);
 }
 
 void IWRAM::write16(uint32 offset, uint16 value) {
@@ -47,6 +48,7 @@ void IWRAM::write16(uint32 offset, uint16 value) {
 		return;
 	}
 	m_iwram.write16(offset, value);
+	m_writes.on_write(offset);
 }
 
 void IWRAM::write32(uint32 offset, uint32 value) {
@@ -56,8 +58,14 @@ void IWRAM::write32(uint32 offset, uint32 value) {
 		return;
 	}
 	m_iwram.write32(offset, value);
+	m_writes.on_write(offset);
+}
+
+HostMapping IWRAM::host_mapping(uint32) {
+	return { &m_iwram.array()[0], 0x7fffu, HostRead | HostWrite | HostWriteByte, &m_writes };
 }
 
 void IWRAM::reload() {
 	std::memset(&m_iwram.array()[0], 0x0, m_iwram.size());
+	m_writes.invalidate_all();
 }
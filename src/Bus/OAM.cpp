@@ -1,4 +1,5 @@
 #include "Bus/OAM.hpp"
+#include <bit>
 #include <cstring>
 
 uint8 OAM::read8(uint32 offset) {
@@ -21,15 +22,78 @@ void OAM::write8(uint32, uint8) {
 }
 
 void OAM::write16(uint32 offset, uint16 value) {
+	if(m_write_log) {
+		m_write_log->record(offset, value, 2);
+	}
 	offset = mirror(offset);
 	m_oam.write16(offset, value);
+	mark_changed(offset, 2);
 }
 
 void OAM::write32(uint32 offset, uint32 value) {
+	if(m_write_log) {
+		m_write_log->record(offset, value, 4);
+	}
 	offset = mirror(offset);
 	m_oam.write32(offset, value);
+	mark_changed(offset, 4);
+}
+
+/*
+ *  Games rewrite the whole OAM every frame, mostly with the same values, so
+ *  only entries whose shape differs from the last line update become dirty.
+ */
+void OAM::mark_changed(uint32 offset, uint32 size) {
+	for(unsigned obj = offset / 8; obj <= (offset + size - 1) / 8; ++obj) {
+		if(m_oam.read32(obj * 8) != m_shapes[obj]) {
+			m_dirty[obj / 64] |= 1ull << (obj % 64);
+		}
+	}
+}
+
+void OAM::update_line_sprites() {
+	for(unsigned word = 0; word < m_dirty.size(); ++word) {
+		for(uint64 dirty = m_dirty[word]; dirty; dirty &= dirty - 1) {
+			const unsigned obj = word * 64 + std::countr_zero(dirty);
+			const uint64 bit = 1ull << (obj % 64);
+			const auto attr = readT<OBJAttr>(obj * 8);
+			const bool enabled = attr.is_enabled();
+			m_shapes[obj] = m_oam.read32(obj * 8);
+
+			for(unsigned ly = 0; ly < visible_lines; ++ly) {
+				auto& sprites = m_line_sprites[ly][word];
+				sprites = (enabled && attr.contains_line(ly)) ? (sprites | bit) : (sprites & ~bit);
+			}
+		}
+		m_dirty[word] = 0;
+	}
+}
+
+unsigned OAM::sprite_count_on_line(uint16 ly) {
+	auto const& sprites = sprites_on_line(ly);
+	return std::popcount(sprites[0]) + std::popcount(sprites[1]);
+}
+
+HostMapping OAM::host_mapping(uint32) {
+	//  Byte writes are ignored, so they go through the device
+	return { &m_oam.array()[0], 0x3ffu, HostRead | HostWrite, this };
+}
+
+void OAM::on_write(uint32 address, uint32 size) {
+	const uint32 first = mirror(address) & ~1u;
+	if(m_write_log) {
+		for(uint32 offset = first; offset < first + size; offset += 2) {
+			m_write_log->record(offset, m_oam.read16(offset), 2);
+		}
+	}
+	mark_changed(first, size);
 }
 
 void OAM::reload() {
+	if(m_write_log) {
+		m_write_log->record_reload();
+	}
 	std::memset(&m_oam.array()[0], 0x0, m_oam.size());
+	m_dirty.fill(~0ull);
+	m_shapes.fill(0);
 }
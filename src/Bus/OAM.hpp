@@ -1,17 +1,48 @@
 #pragma once
+#include <array>
 #include "Bus/Common/BusDevice.hpp"
 #include "Bus/Common/ReaderArray.hpp"
+#include "Bus/Common/WriteLog.hpp"
+#include "Bus/Common/WriteTracker.hpp"
+#include "Bus/IO/PPU.hpp"
 #include "Emulator/StdTypes.hpp"
 
-class OAM final : public BusDevice {
+class OAM final : public BusDevice,
+                  public WriteTracker {
+public:
+	static constexpr unsigned obj_count = 128;
+	static constexpr unsigned visible_lines = 160;
+	//  One bit per OAM entry, in drawing order
+	using SpriteSet = std::array<uint64, obj_count / 64>;
+private:
 	ReaderArray<1 * kB> m_oam;
+	WriteLog* m_write_log { nullptr };
+
+	/*
+	 *  Sprites covering each visible line. Writes that change attributes 0
+	 *  or 1 of an entry, which decide the lines it covers, mark it dirty, and
+	 *  the lines of dirty entries are recomputed the next time the PPU asks
+	 *  for a line.
+	 */
+	std::array<SpriteSet, visible_lines> m_line_sprites {};
+	SpriteSet m_dirty { ~0ull, ~0ull };
+	//  Attributes 0 and 1 of every entry, as of the last line update
+	std::array<uint32, obj_count> m_shapes {};
 
 	static constexpr inline uint32 mirror(uint32 address) { return address & 0x3ff; }
+
+	void mark_changed(uint32 offset, uint32 size);
+
+	void update_line_sprites();
 public:
 	OAM(GaBber& emu)
 	    : BusDevice(emu, 0x07000000, 0x08000000)
 	    , m_oam() {}
 
+	OAM(GaBber& emu, DetachedDevice detached)
+	    : BusDevice(emu, 0x07000000, 0x08000000, detached)
+	    , m_oam() {}
+
 	uint8 read8(uint32 offset) override;
 	uint16 read16(uint32 offset) override;
 	uint32 read32(uint32 offset) override;
@@ -25,6 +56,21 @@ public:
 		return m_oam.template readT<T>(offset);
 	}
 
+	SpriteSet const& sprites_on_line(uint16 ly) {
+		if(m_dirty[0] | m_dirty[1]) {
+			update_line_sprites();
+		}
+		return m_line_sprites[ly];
+	}
+
+	unsigned sprite_count_on_line(uint16 ly);
+
+	//  Records every write to the given log, if set
+	void set_write_log(WriteLog* log) { m_write_log = log; }
+
+	HostMapping host_mapping(uint32 offset) override;
+	void on_write(uint32 address, uint32 size) override;
+
 	void reload() override;
 
 	unsigned int waitcycles32() const override { return 1; }
@@ -17,24 +17,60 @@ uint32 Palette::read32(uint32 offset) {
 }
 
 void Palette::write8(uint32 offset, uint8 value) {
+	if(m_write_log) {
+		m_write_log->record(offset, value, 1);
+	}
 	offset = mirror(offset) & ~1u;
 
 	//  8-bit value is written to both the upper and lower 8-bits
 	//  of the nearest half-word
 	m_palette.write8(offset, value);
 	m_palette.write8(offset + 1, value);
+	update_rgba(offset);
 }
 
 void Palette::write16(uint32 offset, uint16 value) {
+	if(m_write_log) {
+		m_write_log->record(offset, value, 2);
+	}
 	offset = mirror(offset);
 	m_palette.write16(offset, value);
+	update_rgba(offset);
 }
 
 void Palette::write32(uint32 offset, uint32 value) {
+	if(m_write_log) {
+		m_write_log->record(offset, value, 4);
+	}
 	offset = mirror(offset);
 	m_palette.write32(offset, value);
+	update_rgba(offset);
+	update_rgba(offset + 2);
+}
+
+HostMapping Palette::host_mapping(uint32) {
+	//  Byte writes are duplicated into both halves, so they go through the device
+	return { &m_palette.array()[0], 0x3ffu, HostRead | HostWrite, this };
+}
+
+/*
+ *  Converts the colors written through host memory, which only happens in
+ *  whole halfwords or words.
+ */
+void Palette::on_write(uint32 address, uint32 size) {
+	const uint32 first = mirror(address) & ~1u;
+	for(uint32 offset = first; offset < first + size; offset += 2) {
+		if(m_write_log) {
+			m_write_log->record(offset, m_palette.read16(offset), 2);
+		}
+		update_rgba(offset);
+	}
 }
 
 void Palette::reload() {
+	if(m_write_log) {
+		m_write_log->record_reload();
+	}
 	std::memset(&m_palette.array()[0], 0x0, m_palette.size());
+	m_rgba.fill(color_to_rgba32(Color { 0 }));
 }
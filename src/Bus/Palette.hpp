@@ -1,17 +1,31 @@
 #pragma once
+#include <array>
 #include "Bus/Common/BusDevice.hpp"
 #include "Bus/Common/ReaderArray.hpp"
+#include "Bus/Common/WriteLog.hpp"
+#include "Bus/Common/WriteTracker.hpp"
+#include "Bus/IO/PPU.hpp"
 #include "Emulator/StdTypes.hpp"
 
-class Palette final : public BusDevice {
+class Palette final : public BusDevice,
+                      public WriteTracker {
 	ReaderArray<1 * kB> m_palette;
+	WriteLog* m_write_log { nullptr };
+	//  Every color converted to the host framebuffer format, kept up to date on writes
+	std::array<uint32, 512> m_rgba {};
 
 	static constexpr inline uint32 mirror(uint32 address) { return address & 0x3ff; }
+
+	void update_rgba(uint32 offset) { m_rgba[offset / 2] = color_to_rgba32(m_palette.read16(offset & ~1u)); }
 public:
 	Palette(GaBber& emu)
 	    : BusDevice(emu, 0x05000000, 0x06000000)
 	    , m_palette() {}
 
+	Palette(GaBber& emu, DetachedDevice detached)
+	    : BusDevice(emu, 0x05000000, 0x06000000, detached)
+	    , m_palette() {}
+
 	uint8 read8(uint32 offset) override;
 	uint16 read16(uint32 offset) override;
 	uint32 read32(uint32 offset) override;
@@ -25,6 +39,20 @@ public:
 		return m_palette.template readT<T>(offset);
 	}
 
+	static constexpr inline uint32 color_to_rgba32(Color const& color) {
+		uint32 result = (color.red << 27u) | (color.green << 19u) | (color.blue << 11u) | 0xFF;
+		return result;
+	}
+
+	//  Color at the given index, BG colors come first and OBJ colors start at index 256
+	uint32 rgba(uint16 index) const { return m_rgba[index]; }
+
+	//  Records every write to the given log, if set
+	void set_write_log(WriteLog* log) { m_write_log = log; }
+
+	HostMapping host_mapping(uint32 offset) override;
+	void on_write(uint32 address, uint32 size) override;
+
 	void reload() override;
 
 	unsigned int waitcycles32() const override { return 2; }
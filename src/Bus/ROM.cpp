@@ -1,40 +1,57 @@
 #include "Bus/ROM.hpp"
+#include <algorithm>
+#include "Bus/Common/BusInterface.hpp"
+
+bool ROM::from_file(std::string const& path) {
+	if(!m_mapping.open(path)) {
+		return false;
+	}
+	m_rom = {};
+	m_data = m_mapping.data();
+	m_size = std::min<size_t>(m_mapping.size(), max_size);
+	bus().remap();
+	return true;
+}
 
 void ROM::from_vec(std::vector<uint8>&& vec) {
-	m_rom = vec;
-	if(m_rom.size() > 32 * MB) {
-		m_rom.resize(32 * MB);
+	m_mapping.close();
+	m_rom = std::move(vec);
+	if(m_rom.size() > max_size) {
+		m_rom.resize(max_size);
 	}
+	m_data = m_rom.data();
+	m_size = m_rom.size();
+	bus().remap();
 }
 
 uint8 ROM::read8(uint32 offset) {
 	offset = mirror(offset);
 
-	if(offset >= m_rom.size()) {
+	if(offset >= m_size) {
 		//  FIXME: unreadable I/O register
 		return 0xBA;
 	}
-	return m_rom[offset];
+	return m_data[offset];
 }
 
 uint16 ROM::read16(uint32 offset) {
 	offset = mirror(offset);
 
-	if(offset >= m_rom.size() || offset + 1 >= m_rom.size()) {
+	if(offset >= m_size || offset + 1 >= m_size) {
 		//  FIXME: unreadable I/O register
 		return 0xBABE;
 	}
-	return *reinterpret_cast<uint16*>(&m_rom[0] + offset);
+	return *reinterpret_cast<uint16 const*>(m_data + offset);
 }
 
 uint32 ROM::read32(uint32 offset) {
 	offset = mirror(offset);
 
-	if(offset >= m_rom.size() || offset + 3 >= m_rom.size()) {
+	if(offset >= m_size || offset + 3 >= m_size) {
 		//  FIXME: unreadable I/O register
 		return 0xBABEBABE;
 	}
-	return *reinterpret_cast<uint32*>(&m_rom[0] + offset);
+	return *reinterpret_cast<uint32 const*>(m_data + offset);
 }
 
 void ROM::write8(uint32, uint8) {}
@@ -42,3 +59,14 @@ void ROM::write8(uint32, uint8) {}
 void ROM::write16(uint32, uint16) {}
 
 void ROM::write32(uint32, uint32) {}
+
+HostMapping ROM::host_mapping(uint32 offset) {
+	offset = mirror(offset);
+
+	//  Pages partially past the end of the ROM still need the open bus handling
+	if(offset + BusInterface::page_size > m_size) {
+		return {};
+	}
+	//  Only read access is handed out, so the memory is never written through the mapping
+	return { const_cast<uint8*>(m_data) + offset, BusInterface::page_size - 1, HostRead };
+}
@@ -1,18 +1,28 @@
 #pragma once
+#include <span>
+#include <string>
 #include <vector>
 #include "Bus/Common/BusDevice.hpp"
+#include "Bus/Common/MappedFile.hpp"
 #include "Emulator/StdTypes.hpp"
 
 class ROM final : public BusDevice {
+	//  The ROM is either mapped straight from the file, or held in memory
+	MappedFile m_mapping {};
 	std::vector<uint8> m_rom {};
+	uint8 const* m_data { nullptr };
+	uint32 m_size { 0 };
 
 	static constexpr inline uint32 mirror(uint32 offset) { return offset % 0x02000000; }
+	static constexpr const uint32 max_size = 32 * MB;
 public:
 	ROM(GaBber& emu)
 	    : BusDevice(emu, 0x08000000, 0x0e000000)
 	    , m_rom() {}
 
+	bool from_file(std::string const& path);
 	void from_vec(std::vector<uint8>&& vec);
+	std::span<uint8 const> contents() const { return { m_data, m_size }; }
 
 	uint8 read8(uint32 offset) override;
 	uint16 read16(uint32 offset) override;
@@ -21,7 +31,9 @@ public:
 	void write16(uint32, uint16) override;
 	void write32(uint32, uint32) override;
 
+	HostMapping host_mapping(uint32 offset) override;
+
 	unsigned int waitcycles32() const override { return 8; }
 	unsigned int waitcycles16() const override { return 5; }
 	unsigned int waitcycles8() const override { return 5; }
-};
\ No newline at end of file
+};
@@ -1,5 +1,6 @@
 #include "Bus/VRAM.hpp"
 #include <cstring>
+#include "Bus/Common/BusInterface.hpp"
 
 uint8 VRAM::read8(uint32 offset) {
 	offset = offset_in_mirror(offset);
@@ -17,6 +18,9 @@ uint32 VRAM::read32(uint32 offset) {
 }
 
 void VRAM::write8(uint32 offset, uint8 value) {
+	if(m_write_log) {
+		m_write_log->record(offset, value, 1);
+	}
 	offset = offset_in_mirror(offset) & ~1u;
 
 	//  8-bit writes ignored to OBJ
@@ -29,18 +33,55 @@ void VRAM::write8(uint32 offset, uint8 value) {
 	//  of the nearest half-word
 	m_vram.write8(offset, value);
 	m_vram.write8(offset + 1, value);
+	mark_dirty(offset);
 }
 
 void VRAM::write16(uint32 offset, uint16 value) {
+	if(m_write_log) {
+		m_write_log->record(offset, value, 2);
+	}
 	offset = offset_in_mirror(offset);
 	m_vram.write16(offset, value);
+	mark_dirty(offset);
 }
 
 void VRAM::write32(uint32 offset, uint32 value) {
+	if(m_write_log) {
+		m_write_log->record(offset, value, 4);
+	}
 	offset = offset_in_mirror(offset);
 	m_vram.write32(offset, value);
+	mark_dirty(offset);
+}
+
+HostMapping VRAM::host_mapping(uint32 offset) {
+	//  Pages never straddle the 96KiB/128KiB mirror boundary. Byte writes are
+	//  duplicated into both halves, so they go through the device
+	return { &m_vram.array()[0] + offset_in_mirror(offset), BusInterface::page_size - 1, HostRead | HostWrite, this };
+}
+
+/*
+ *  Marks the tiles written through host memory dirty. The span never crosses
+ *  a page, so it is contiguous in VRAM as well.
+ */
+void VRAM::on_write(uint32 address, uint32 size) {
+	const uint32 first = offset_in_mirror(address - start()) & ~1u;
+	if(m_write_log) {
+		const uint32 step = (first % 4 == 0 && size % 4 == 0) ? 4 : 2;
+		for(uint32 offset = first; offset < first + size; offset += step) {
+			const uint32 value = step == 4 ? m_vram.read32(offset) : m_vram.read16(offset);
+			m_write_log->record(offset, value, step);
+		}
+	}
+	for(uint32 tile = first / tile_bytes; tile <= (first + size - 1) / tile_bytes; ++tile) {
+		m_dirty_tiles[tile / 64] |= 1ull << (tile % 64);
+	}
 }
 
 void VRAM::reload() {
+	if(m_write_log) {
+		m_write_log->record_reload();
+	}
 	std::memset(&m_vram.array()[0], 0x0, m_vram.size());
+	m_dirty_tiles.fill(~0ull);
 }
@@ -1,10 +1,22 @@
 #pragma once
+#include <array>
 #include "Bus/Common/BusDevice.hpp"
 #include "Bus/Common/ReaderArray.hpp"
+#include "Bus/Common/WriteLog.hpp"
+#include "Bus/Common/WriteTracker.hpp"
 #include "Emulator/StdTypes.hpp"
 
-class VRAM final : public BusDevice {
+class VRAM final : public BusDevice,
+                   public WriteTracker {
+public:
+	//  Size of a 4bpp tile, the granularity of the dirty bitmap
+	static constexpr uint32 tile_bytes = 32;
+	static constexpr uint32 tile_count = 96 * kB / tile_bytes;
+private:
 	ReaderArray<96 * kB> m_vram;
+	WriteLog* m_write_log { nullptr };
+	//  Tiles written since they were last decoded by the tile cache
+	std::array<uint64, tile_count / 64> m_dirty_tiles;
 
 	static constexpr inline uint32 mirror(uint32 address) { return address % (128 * kB); }
 
@@ -16,10 +28,23 @@ class VRAM final : public BusDevice {
 
 		return mirrored;
 	}
+
+	inline void mark_dirty(uint32 offset) {
+		const uint32 tile = offset / tile_bytes;
+		m_dirty_tiles[tile / 64] |= 1ull << (tile % 64);
+	}
 public:
 	VRAM(GaBber& emu)
 	    : BusDevice(emu, 0x06000000, 0x07000000)
-	    , m_vram() {}
+	    , m_vram() {
+		m_dirty_tiles.fill(~0ull);
+	}
+
+	VRAM(GaBber& emu, DetachedDevice detached)
+	    : BusDevice(emu, 0x06000000, 0x07000000, detached)
+	    , m_vram() {
+		m_dirty_tiles.fill(~0ull);
+	}
 
 	uint8 read8(uint32 offset) override;
 	uint16 read16(uint32 offset) override;
@@ -34,6 +59,18 @@ public:
 		return m_vram.template readT<T>(offset_in_mirror(offset));
 	}
 
+	static constexpr inline uint32 tile_index(uint32 offset) { return offset_in_mirror(offset) / tile_bytes; }
+
+	bool is_tile_dirty(uint32 tile) const { return m_dirty_tiles[tile / 64] & (1ull << (tile % 64)); }
+
+	void clear_tile_dirty(uint32 tile) { m_dirty_tiles[tile / 64] &= ~(1ull << (tile % 64)); }
+
+	//  Records every write to the given log, if set
+	void set_write_log(WriteLog* log) { m_write_log = log; }
+
+	HostMapping host_mapping(uint32 offset) override;
+	void on_write(uint32 address, uint32 size) override;
+
 	void reload() override;
 
 	unsigned int waitcycles32() const override { return 2; }
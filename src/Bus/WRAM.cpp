@@ -38,6 +38,7 @@ void WRAM::write8(uint32 offset, uint8 value) {
 		return;
 	}
 	m_wram.write8(offset, value);
+	m_writes.on_write(offset);
 }
 
 void WRAM::write16(uint32 offset, uint16 value) {
@@ -47,6 +48,7 @@ void WRAM::write16(uint32 offset, uint16 value) {
 		return;
 	}
 	m_wram.write16(offset, value);
+	m_writes.on_write(offset);
 }
 
 void WRAM::write32(uint32 offset, uint32 value) {
@@ -56,8 +58,14 @@ void WRAM::write32(uint32 offset, uint32 value) {
 		return;
 	}
 	m_wram.write32(offset, value);
+	m_writes.on_write(offset);
+}
+
+HostMapping WRAM::host_mapping(uint32) {
+	return { &m_wram.array()[0], 0x3ffffu, HostRead | HostWrite | HostWriteByte, &m_writes };
 }
 
 void WRAM::reload() {
 	std::memset(&m_wram.array()[0], 0x0, m_wram.size());
+	m_writes.invalidate_all();
 }
@@ -1,10 +1,12 @@
 #pragma once
 #include "Bus/Common/BusDevice.hpp"
 #include "Bus/Common/ReaderArray.hpp"
+#include "Bus/Common/WriteTracker.hpp"
 #include "Emulator/StdTypes.hpp"
 
 class WRAM final : public BusDevice {
 	ReaderArray<256 * kB> m_wram;
+	CodeTracker m_writes { 256 * kB };
 
 	static constexpr inline uint32 mirror(uint32 address) { return address & 0x3ffffu; }
 public:
@@ -20,6 +22,8 @@ public:
 	void write16(uint32 offset, uint16 value) override;
 	void write32(uint32 offset, uint32 value) override;
 
+	HostMapping host_mapping(uint32 offset) override;
+
 	void reload() override;
 
 	unsigned int waitcycles32() const override { return 6; }
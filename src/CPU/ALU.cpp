@@ -50,35 +50,24 @@ uint32 ARM7TDMI::evaluate_operand2(arm::DataProcessInstruction instr, bool affec
 void ARM7TDMI::_alu_set_flags_logical_op(uint32 result) {
 	//  V not affected
 	//  C should be set at this point by the shift operation
-	cspr().set(CSPR_REGISTERS::Zero, result == 0);
-	cspr().set(CSPR_REGISTERS::Negative, result & (1u << 31u));
+	cspr().defer_nz(result);
 }
 
 uint32 ARM7TDMI::_alu_add(uint32 op1, uint32 op2, bool should_affect_flags) {
-	if(should_affect_flags)
-		cspr().set(CSPR_REGISTERS::Carry, (static_cast<uint64>(op1) + static_cast<uint64>(op2)) > 0xfffffffful);
-
 	const uint32 v = op1 + op2;
 
 	if(should_affect_flags) {
-		const bool overflow = (Bits::bit<31>(op1) == Bits::bit<31>(op2)) && (Bits::bit<31>(v) != Bits::bit<31>(op1));
-		cspr().set(CSPR_REGISTERS::Overflow, overflow);
-		_alu_set_flags_logical_op(v);
+		cspr().defer_nzcv(op1, op2, false);
 	}
 
 	return v;
 }
 
 uint32 ARM7TDMI::_alu_sub(uint32 op1, uint32 op2, bool should_affect_flags) {
-	if(should_affect_flags)
-		cspr().set(CSPR_REGISTERS::Carry, op1 >= op2);
-
 	const uint32 v = op1 - op2;
 
 	if(should_affect_flags) {
-		const bool overflow = (Bits::bit<31>(op1) != Bits::bit<31>(op2)) && (Bits::bit<31>(v) == Bits::bit<31>(op2));
-		cspr().set(CSPR_REGISTERS::Overflow, overflow);
-		_alu_set_flags_logical_op(v);
+		cspr().defer_nzcv(op1, ~op2, true);
 	}
 
 	return v;
@@ -90,11 +79,7 @@ uint32 ARM7TDMI::_alu_adc(uint32 op1, uint32 op2, bool should_affect_flags) {
 	uint32 result = op1 + op2 + C;
 
 	if(should_affect_flags) {
-		const bool new_C = ((uint64)op1 + (uint64)op2 + (uint64)C) > 0xfffffffful;
-		const bool new_V = (Bits::bit<31>(op1) == Bits::bit<31>(op2)) && (Bits::bit<31>(result) != Bits::bit<31>(op1));
-		cspr().set(CSPR_REGISTERS::Carry, new_C);
-		cspr().set(CSPR_REGISTERS::Overflow, new_V);
-		_alu_set_flags_logical_op(result);
+		cspr().defer_nzcv(op1, op2, C);
 	}
 
 	return result;
@@ -106,11 +91,7 @@ uint32 ARM7TDMI::_alu_sbc(uint32 op1, uint32 op2, bool should_affect_flags) {
 	uint32 result = op1 - op2 - C;
 
 	if(should_affect_flags) {
-		const bool new_C = ((uint64)op1 >= (uint64)op2 + (uint64)C);
-		const bool new_V = (Bits::bit<31>(op1) != Bits::bit<31>(op2)) && (Bits::bit<31>(result) == Bits::bit<31>(op2));
-		cspr().set(CSPR_REGISTERS::Carry, new_C);
-		cspr().set(CSPR_REGISTERS::Overflow, new_V);
-		_alu_set_flags_logical_op(result);
+		cspr().defer_nzcv(op1, ~op2, !C);
 	}
 
 	return result;
@@ -1,10 +1,13 @@
 #include "CPU/ARM7TDMI.hpp"
+#include <algorithm>
 #include "Bus/Common/BusInterface.hpp"
 #include "Debugger/Debugger.hpp"
+#include "Emulator/Config.hpp"
 #include "Emulator/GaBber.hpp"
 
 ARM7TDMI::ARM7TDMI(GaBber& emu)
-    : Module(emu) {}
+    : Module(emu)
+    , m_dynarec(emu) {}
 
 void ARM7TDMI::reset() {
 	cspr().set_state(INSTR_MODE::ARM);
@@ -20,8 +23,9 @@ void ARM7TDMI::reset() {
 	m_saved_status.m_UND.set_raw(0x10);
 
 	for(unsigned i = 0; i < 16; ++i) {
-		m_registers.m_base[i] = 0;
+		m_registers.m_active[i] = 0;
 		if(i < 7) {
+			m_registers.m_gUSR[i] = 0;
 			m_registers.m_gFIQ[i] = 0;
 		}
 		if(i < 2) {
@@ -35,12 +39,15 @@ void ARM7TDMI::reset() {
 	pc() = 0x0 + 8;
 	//	pc() = 0xFFFF0000 + 8;
 	m_pc_dirty = false;
+	m_idle_loop = {};
+	m_idle = false;
+	m_hle_intr_waiting = false;
+	invalidate_fetch_window();
+	clear_block_cache();
 }
 
 unsigned ARM7TDMI::run_next_instruction() {
 	const unsigned n = run_to_next_state();
-	timers_cycle_all(n);
-
 	m_cycles += n;
 	return n;
 }
@@ -54,32 +61,135 @@ unsigned ARM7TDMI::run_to_next_state() {
 		return m_wait_cycles;
 	}
 
-	//  If in halt, emulate it cycle-by-cycle
+	//  If in halt, nothing happens until the next event
 	if(handle_halt()) {
-		return 1;
+		return std::max(1u, cycles_to_next_event());
 	}
 
 	handle_interrupts();
-	exec_opcode();
+	if(!(config().cpu_dynarec && m_dynarec.execute())) {
+		exec_opcode();
+	}
+
+	if(m_idle) {
+		m_idle = false;
+		m_wait_cycles += cycles_to_next_event();
+	}
 
 	return m_wait_cycles;
 }
 
+uint32& ARM7TDMI::bank_slot(PRIV_MODE mode, uint8 num) {
+	assert(num >= 8 && num <= 14);
+	const unsigned i = num - 8;
+	if(mode == PRIV_MODE::FIQ) {
+		return m_registers.m_gFIQ[i];
+	}
+	if(num <= 12) {
+		return m_registers.m_gUSR[i];
+	}
+	switch(mode) {
+		case PRIV_MODE::SYS:
+		case PRIV_MODE::USR: return m_registers.m_gUSR[i];
+		case PRIV_MODE::SVC: return m_registers.m_gSVC[num - 13];
+		case PRIV_MODE::ABT: return m_registers.m_gABT[num - 13];
+		case PRIV_MODE::IRQ: return m_registers.m_gIRQ[num - 13];
+		case PRIV_MODE::UND: return m_registers.m_gUND[num - 13];
+		default: ASSERT_NOT_REACHED();
+	}
+}
+
+uint32 ARM7TDMI::banked_reg(PRIV_MODE mode, uint8 num) const {
+	assert(num < 16);
+	if(num < 8 || num == 15 || &bank_slot(mode, num) == &bank_slot(cspr().mode(), num)) {
+		return creg(num);
+	}
+	return bank_slot(mode, num);
+}
+
+uint32& ARM7TDMI::user_reg(uint8 num) {
+	assert(num < 16);
+	if(num < 8 || num == 15 || &bank_slot(PRIV_MODE::USR, num) == &bank_slot(cspr().mode(), num)) {
+		return reg(num);
+	}
+	return bank_slot(PRIV_MODE::USR, num);
+}
+
+void ARM7TDMI::swap_register_bank(PRIV_MODE previous) {
+	const auto current = cspr().mode();
+	if(current == previous) {
+		return;
+	}
+	for(uint8 num = 8; num <= 14; ++num) {
+		auto& from = bank_slot(previous, num);
+		auto& to = bank_slot(current, num);
+		//  Registers shared between both modes stay in place
+		if(&from == &to) {
+			continue;
+		}
+		from = m_registers.m_active[num];
+		m_registers.m_active[num] = to;
+	}
+}
+
 uint32 ARM7TDMI::fetch_instruction() {
-	const auto op = (cspr().state() == INSTR_MODE::ARM) ? mem_read_arm_opcode(const_pc() - 2 * current_instr_len())
-	                                                    : mem_read_thumb_opcode(const_pc() - 2 * current_instr_len());
+	const uint32 address = const_pc() - 2 * current_instr_len();
+	auto const& window = m_fetch_window;
+	if(address - window.lo < window.hi - window.lo || refresh_fetch_window(address)) [[likely]] {
+		auto const* opcode = window.base + (address - window.lo);
+		return (cspr().state() == INSTR_MODE::ARM) ? *reinterpret_cast<uint32 const*>(opcode)
+		                                           : *reinterpret_cast<uint16 const*>(opcode);
+	}
+
+	const auto op = (cspr().state() == INSTR_MODE::ARM) ? mem_read_arm_opcode(address) : mem_read_thumb_opcode(address);
 	return op;
 }
 
+bool ARM7TDMI::refresh_fetch_window(uint32 address) {
+	m_fetch_window = {};
+	auto const* mapping = bus().host_mapping(address);
+	if(!mapping || !(mapping->access & HostRead)) {
+		return false;
+	}
+	//  Bus pages are smaller than breakpoint pages, so the window is either
+	//  entirely covered by a breakpoint page or not at all
+	if(debugger().is_armed(address, BreakRead)) {
+		return false;
+	}
+
+	//  Mirrors smaller than a page are covered one mirror at a time
+	const uint32 window_size = std::min<uint32>(BusInterface::page_size, mapping->mask + 1);
+	const uint32 lo = address & ~(window_size - 1);
+	const auto span = bus().host_span(lo, HostRead);
+	if(!span.data) {
+		return false;
+	}
+	m_fetch_window = { span.data, lo, lo + span.size };
+	return true;
+}
+
 void ARM7TDMI::exec_opcode() {
-	const auto opcode = fetch_instruction();
-	debugger().on_execute_opcode(const_pc() - 2 * current_instr_len());
+	const auto opcode_address = const_pc() - 2 * current_instr_len();
+	if(!execute_cached(opcode_address)) {
+		const auto opcode = fetch_instruction();
+		if(debugger().is_armed(opcode_address, BreakExec)) {
+			debugger().on_execute_opcode(opcode_address);
+		}
 
-	if(cspr().state() == INSTR_MODE::ARM)
-		execute_ARM(opcode);
-	else
-		execute_THUMB(opcode);
+		if(cspr().state() == INSTR_MODE::ARM)
+			execute_ARM(opcode);
+		else
+			execute_THUMB(opcode);
+	}
+
+	const bool branched = m_pc_dirty;
+	advance_pc();
+	if(branched && config().cpu_idle_loop_skip) {
+		idle_loop_check(opcode_address);
+	}
+}
 
+void ARM7TDMI::advance_pc() {
 	//  Always make sure the PC is 2 instructions ahead
 	if(m_pc_dirty) {
 		pc() += 2 * current_instr_len();
@@ -94,11 +204,9 @@ void ARM7TDMI::exec_opcode() {
 }
 
 void ARM7TDMI::execute_ARM(uint32 opcode) {
-	if(!cspr().evaluate_condition(disarmv4t::arm::instr::Instruction(opcode).condition())) {
-		//  Unevaluated instructions take one S-cycle
-		m_wait_cycles += mem_waits_access32(const_pc(), AccessType::Seq);
-		return;
-	}
+	const auto type = disarmv4t::arm::decode_fast(opcode);
+	(this->*s_arm_handlers[static_cast<size_t>(type)])(opcode);
+}
 
 #define BADOP(op)                               \
 	case op:                                    \
@@ -107,48 +215,10 @@ void ARM7TDMI::execute_ARM(uint32 opcode) {
 		m_wait_cycles += 1;                     \
 		break
 
+void ARM7TDMI::ARM_undefined(uint32 opcode) {
 	auto op = disarmv4t::arm::decode(opcode);
 	switch(op) {
-		case disarmv4t::arm::InstructionType::BBL: {
-			this->B(disarmv4t::arm::instr::BInstruction(opcode));
-			return;
-		}
-		case disarmv4t::arm::InstructionType::BX: {
-			this->BX(disarmv4t::arm::instr::BXInstruction(opcode));
-			return;
-		}
-		case disarmv4t::arm::InstructionType::ALU: {
-			this->DPI(disarmv4t::arm::instr::DataProcessInstruction(opcode));
-			return;
-		}
-		case disarmv4t::arm::InstructionType::MUL: {
-			this->MUL(disarmv4t::arm::instr::MultInstruction(opcode));
-			return;
-		}
-		case disarmv4t::arm::InstructionType::MLL: {
-			this->MLL(disarmv4t::arm::instr::MultLongInstruction(opcode));
-			return;
-		}
-		case disarmv4t::arm::InstructionType::SDT: {
-			this->SDT(disarmv4t::arm::instr::SDTInstruction(opcode));
-			return;
-		}
-		case disarmv4t::arm::InstructionType::HDT: {
-			this->HDT(disarmv4t::arm::instr::HDTInstruction(opcode));
-			return;
-		}
-		case disarmv4t::arm::InstructionType::BDT: {
-			this->BDT(disarmv4t::arm::instr::BDTInstruction(opcode));
-			return;
-		}
-		case disarmv4t::arm::InstructionType::SWP: {
-			this->SWP(disarmv4t::arm::instr::SWPInstruction(opcode));
-			return;
-		}
-		case disarmv4t::arm::InstructionType::SWI: {
-			this->SWI(disarmv4t::arm::instr::SWIInstruction(opcode));
-			return;
-		}// clang-format off
+		// clang-format off
 		BADOP(disarmv4t::arm::InstructionType::CODT);
 		BADOP(disarmv4t::arm::InstructionType::CO9);
 		BADOP(disarmv4t::arm::InstructionType::CODO);
@@ -168,84 +238,13 @@ void ARM7TDMI::execute_ARM(uint32 opcode) {
 }
 
 void ARM7TDMI::execute_THUMB(uint16 opcode) {
+	(this->*s_thumb_handlers[opcode >> 6u])(opcode);
+}
+
+void ARM7TDMI::THUMB_undefined(uint16 opcode) {
 	auto op = disarmv4t::thumb::decode(opcode);
 	switch(op) {
-		case disarmv4t::thumb::InstructionType::FMT1: {
-			THUMB_FMT1(disarmv4t::thumb::instr::InstructionFormat1(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT2: {
-			THUMB_FMT2(disarmv4t::thumb::instr::InstructionFormat2(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT3: {
-			THUMB_FMT3(disarmv4t::thumb::instr::InstructionFormat3(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT4: {
-			THUMB_ALU(disarmv4t::thumb::instr::InstructionFormat4(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT5: {
-			THUMB_FMT5(disarmv4t::thumb::instr::InstructionFormat5(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT6: {
-			THUMB_FMT6(disarmv4t::thumb::instr::InstructionFormat6(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT7: {
-			THUMB_FMT7(disarmv4t::thumb::instr::InstructionFormat7(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT8: {
-			THUMB_FMT8(disarmv4t::thumb::instr::InstructionFormat8(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT9: {
-			THUMB_FMT9(disarmv4t::thumb::instr::InstructionFormat9(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT10: {
-			THUMB_FMT10(disarmv4t::thumb::instr::InstructionFormat10(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT11: {
-			THUMB_FMT11(disarmv4t::thumb::instr::InstructionFormat11(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT12: {
-			THUMB_FMT12(disarmv4t::thumb::instr::InstructionFormat12(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT13: {
-			THUMB_FMT13(disarmv4t::thumb::instr::InstructionFormat13(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT14: {
-			THUMB_FMT14(disarmv4t::thumb::instr::InstructionFormat14(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT15: {
-			THUMB_FMT15(disarmv4t::thumb::instr::InstructionFormat15(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT16: {
-			THUMB_FMT16(disarmv4t::thumb::instr::InstructionFormat16(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT17: {
-			THUMB_FMT17(disarmv4t::thumb::instr::InstructionFormat17(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT18: {
-			THUMB_FMT18(disarmv4t::thumb::instr::InstructionFormat18(opcode));
-			return;
-		}
-		case disarmv4t::thumb::InstructionType::FMT19: {
-			THUMB_FMT19(disarmv4t::thumb::instr::InstructionFormat19(opcode));
-			return;
-		}// clang-format off
+		// clang-format off
 		BADOP(disarmv4t::thumb::InstructionType::UD9);
 		BADOP(disarmv4t::thumb::InstructionType::BKPT);
 		BADOP(disarmv4t::thumb::InstructionType::BLX9);
@@ -1,10 +1,15 @@
 #pragma once
+#include <array>
 #include <disarmv4t/arm.hpp>
 #include <disarmv4t/thumb.hpp>
 #include <fmt/format.h>
 #include <memory>
 #include <optional>
+#include <utility>
+#include <vector>
 #include "Bus/IO/Timer.hpp"
+#include "CPU/BlockCache.hpp"
+#include "CPU/Dynarec/Dynarec.hpp"
 #include "CPU/GPR.hpp"
 #include "CPU/PSR.hpp"
 #include "Emulator/Module.hpp"
@@ -22,6 +27,8 @@ enum class ExceptionVector {
 };
 
 enum class AccessType;
+template<unsigned x>
+struct DMAx;
 
 /*
  *  Implementation of the ARM7TDMI processor
@@ -32,6 +39,8 @@ protected:
 	friend class IORegisters;
 	friend class TestHarness;
 	friend class Stacktrace;
+	friend class Dynarec;
+	friend class Translator;
 
 	CSPR m_status;
 	SPSR m_saved_status;
@@ -51,84 +60,78 @@ protected:
 		}
 	}
 
-	uint32 const& cr13() const {
-		switch(cspr().mode()) {
-			case PRIV_MODE::SYS:
-			case PRIV_MODE::USR: return m_registers.m_base[13];
-			case PRIV_MODE::FIQ: return m_registers.m_gFIQ[5];
-			case PRIV_MODE::SVC: return m_registers.m_gSVC[0];
-			case PRIV_MODE::ABT: return m_registers.m_gABT[0];
-			case PRIV_MODE::IRQ: return m_registers.m_gIRQ[0];
-			case PRIV_MODE::UND: return m_registers.m_gUND[0];
-			default: ASSERT_NOT_REACHED();
-		}
-	}
-	uint32& r13() {
-		//  FIXME: This is an abomination
-		return const_cast<uint32&>(static_cast<const ARM7TDMI*>(this)->cr13());
-	}
+	uint32 const& cr13() const { return m_registers.m_active[13]; }
+	uint32& r13() { return m_registers.m_active[13]; }
 
-	uint32 const& r14() const {
-		switch(cspr().mode()) {
-			case PRIV_MODE::SYS:
-			case PRIV_MODE::USR: return m_registers.m_base[14];
-			case PRIV_MODE::FIQ: return m_registers.m_gFIQ[6];
-			case PRIV_MODE::SVC: return m_registers.m_gSVC[1];
-			case PRIV_MODE::ABT: return m_registers.m_gABT[1];
-			case PRIV_MODE::IRQ: return m_registers.m_gIRQ[1];
-			case PRIV_MODE::UND: return m_registers.m_gUND[1];
-			default: ASSERT_NOT_REACHED();
-		}
-	}
-	uint32& r14() {
-		//  FIXME: This is an abomination
-		return const_cast<uint32&>(static_cast<const ARM7TDMI*>(this)->r14());
-	}
+	uint32 const& r14() const { return m_registers.m_active[14]; }
+	uint32& r14() { return m_registers.m_active[14]; }
 
 	uint32& pc() {
 		m_pc_dirty = true;
-		return m_registers.m_base[15];
+		return m_registers.m_active[15];
 	}
-	uint32 const& const_pc() const { return m_registers.m_base[15]; }
+	uint32 const& const_pc() const { return m_registers.m_active[15]; }
 	uint32& sp() { return r13(); }
 	uint32& lr() { return r14(); }
 
 	uint32& reg(uint8 num) {
 		assert(num < 16);
-		if(num <= 7)
-			return m_registers.m_base[num];
-		else if(num >= 8 && num <= 12)
-			return (cspr().mode() == PRIV_MODE::FIQ ? m_registers.m_gFIQ[num - 8] : m_registers.m_base[num]);
-		else if(num == 13)
-			return r13();
-		else if(num == 14)
-			return r14();
-		else if(num == 15)
+		if(num == 15)
 			return pc();
-		ASSERT_NOT_REACHED();
+		return m_registers.m_active[num];
 	}
 	uint32 const& creg(uint8 num) const {
 		assert(num < 16);
-		if(num <= 7)
-			return m_registers.m_base[num];
-		else if(num >= 8 && num <= 12)
-			return (cspr().mode() == PRIV_MODE::FIQ ? m_registers.m_gFIQ[num - 8] : m_registers.m_base[num]);
-		else if(num == 13)
-			return cr13();
-		else if(num == 14)
-			return r14();
-		else if(num == 15)
-			return const_pc();
-		ASSERT_NOT_REACHED();
+		return m_registers.m_active[num];
+	}
+
+	/*
+	 *  Storage of the banked copy of R8-R14 for the given mode, which is only
+	 *  up to date while that mode is not active.
+	 */
+	uint32& bank_slot(PRIV_MODE mode, uint8 num);
+	uint32 const& bank_slot(PRIV_MODE mode, uint8 num) const {
+		return const_cast<ARM7TDMI*>(this)->bank_slot(mode, num);
+	}
+	//  Register as seen from the given mode, regardless of the current mode
+	uint32 banked_reg(PRIV_MODE mode, uint8 num) const;
+	//  System/User mode register, used by LDM/STM with the S bit set
+	uint32& user_reg(uint8 num);
+
+	/*
+	 *  Must be called after every write to the CSPR that can change the mode.
+	 *  Swaps the banked registers of the previous mode out of the register file
+	 *  and the ones of the current mode in.
+	 */
+	void swap_register_bank(PRIV_MODE previous);
+	void set_cspr(CSPR value) {
+		const auto previous = cspr().mode();
+		cspr() = value;
+		swap_register_bank(previous);
 	}
 
 	mutable unsigned m_wait_cycles { 0 };
 	uint64 m_cycles { 0 };
 	bool m_pc_dirty { false };
 	void exec_opcode();
+	void advance_pc();
 	void execute_ARM(uint32 opcode);
 	void execute_THUMB(uint16 opcode);
 	uint32 fetch_instruction();
+
+	/*
+	 *  Window of host memory around the PC, so that straight-line code is
+	 *  fetched with a plain pointer dereference instead of going through the
+	 *  bus. Only pages backed by host memory without read breakpoints are
+	 *  covered, and the window is refreshed whenever the PC leaves it.
+	 */
+	struct FetchWindow {
+		uint8 const* base { nullptr };
+		uint32 lo { 0 };
+		uint32 hi { 0 };
+	};
+	FetchWindow m_fetch_window;
+	bool refresh_fetch_window(uint32 address);
 	[[nodiscard]] inline size_t current_instr_len() const { return ((cspr().state() == INSTR_MODE::ARM) ? 4 : 2); }
 
 	bool irqs_enabled_globally() const;
@@ -137,6 +140,49 @@ protected:
 	bool handle_halt();
 	void handle_interrupts();
 
+	/*
+	 *  Short backward loops which only read memory are idle loops if the
+	 *  registers come out unchanged after an iteration. Nothing can change
+	 *  until the next scheduled event, so the remaining time is skipped.
+	 *  Loops polling a timer counter are excluded, as the counter ticks
+	 *  independently of any event.
+	 */
+	struct IdleLoop {
+		uint32 head { 0 };
+		uint32 tail { 0 };
+		bool thumb { false };
+		bool side_effect_free { false };
+		std::array<uint32, 17> state {};
+	};
+	static constexpr uint32 max_idle_loop_bytes = 32;
+	IdleLoop m_idle_loop;
+	bool m_idle { false };
+	bool m_timer_polled { false };
+
+	bool idle_loop_is_side_effect_free(uint32 head, uint32 tail, bool thumb) const;
+	void idle_loop_check(uint32 branch_address);
+	unsigned cycles_to_next_event() const;
+
+	/*  ==============================================
+	 *                  BIOS HLE
+	 *  ==============================================
+	 */
+	bool m_hle_intr_waiting { false };
+	bool hle_swi(uint8 number);
+	void hle_intr_wait(bool discard_old, uint16 flags);
+	void hle_div(int32 numerator, int32 denominator);
+	void hle_cpu_set(uint32 source, uint32 destination, uint32 control);
+	void hle_cpu_fast_set(uint32 source, uint32 destination, uint32 control);
+	void hle_write_uncompressed(uint32 destination, std::vector<uint8> const& data, bool vram);
+	void hle_lz77_uncomp(uint32 source, uint32 destination, bool vram);
+	void hle_rl_uncomp(uint32 source, uint32 destination, bool vram);
+	void hle_huff_uncomp(uint32 source, uint32 destination);
+	void hle_fill32(uint32 destination, uint32 size);
+	void hle_register_ram_reset(uint8 flags);
+	void hle_bg_affine_set(uint32 source, uint32 destination, uint32 count);
+	void hle_obj_affine_set(uint32 source, uint32 destination, uint32 count, uint32 stride);
+	void hle_bit_unpack(uint32 source, uint32 destination, uint32 info);
+
 	void _alu_set_flags_logical_op(uint32 result);
 	uint32 _alu_adc(uint32 op1, uint32 op2, bool should_affect_flags);
 	uint32 _alu_sbc(uint32 op1, uint32 op2, bool should_affect_flags);
@@ -188,6 +234,18 @@ protected:
 	void stack_push32(uint32 val);
 	uint32 stack_pop32();
 
+	/*
+	 *  ARM opcodes are dispatched through a table indexed by their decoded type,
+	 *  the handlers check the condition before executing the instruction.
+	 */
+	using ArmHandler = void (ARM7TDMI::*)(uint32);
+	static const std::array<ArmHandler, static_cast<size_t>(disarmv4t::arm::InstructionType::_end)> s_arm_handlers;
+	template<size_t... types>
+	static constexpr std::array<ArmHandler, sizeof...(types)> make_arm_handlers(std::index_sequence<types...>);
+	template<disarmv4t::arm::InstructionType type>
+	void ARM_dispatch(uint32 opcode);
+	void ARM_undefined(uint32 opcode);
+
 	/*
 	 *  ARM Opcodes
 	 */
@@ -221,24 +279,51 @@ protected:
 	/*
 	 *  THUMB opcodes
 	 */
+	/*
+	 *  Every THUMB opcode is dispatched through a table indexed by its upper 10
+	 *  bits. Handlers are instantiated with the bits that select their variant,
+	 *  so sub-opcodes, flags and high register bits are known at compile time.
+	 */
+	using ThumbHandler = void (ARM7TDMI::*)(uint16);
+	static const std::array<ThumbHandler, 1024> s_thumb_handlers;
+	template<uint16... bits>
+	static constexpr std::array<ThumbHandler, sizeof...(bits)> make_thumb_handlers(std::integer_sequence<uint16, bits...>);
+	template<uint16 bits>
+	void THUMB_dispatch(uint16 opcode);
+	void THUMB_undefined(uint16 opcode);
+
+	template<uint16 bits>
 	void THUMB_FMT1(disarmv4t::thumb::instr::InstructionFormat1);
+	template<uint16 bits>
 	void THUMB_FMT2(disarmv4t::thumb::instr::InstructionFormat2);
+	template<uint16 bits>
 	void THUMB_FMT3(disarmv4t::thumb::instr::InstructionFormat3);
+	template<uint16 bits>
 	void THUMB_FMT5(disarmv4t::thumb::instr::InstructionFormat5);
 	void THUMB_FMT6(disarmv4t::thumb::instr::InstructionFormat6);
+	template<uint16 bits>
 	void THUMB_FMT7(disarmv4t::thumb::instr::InstructionFormat7);
+	template<uint16 bits>
 	void THUMB_FMT8(disarmv4t::thumb::instr::InstructionFormat8);
+	template<uint16 bits>
 	void THUMB_FMT9(disarmv4t::thumb::instr::InstructionFormat9);
+	template<uint16 bits>
 	void THUMB_FMT10(disarmv4t::thumb::instr::InstructionFormat10);
+	template<uint16 bits>
 	void THUMB_FMT11(disarmv4t::thumb::instr::InstructionFormat11);
+	template<uint16 bits>
 	void THUMB_FMT12(disarmv4t::thumb::instr::InstructionFormat12);
 	void THUMB_FMT13(disarmv4t::thumb::instr::InstructionFormat13);
+	template<uint16 bits>
 	void THUMB_FMT14(disarmv4t::thumb::instr::InstructionFormat14);
 	void THUMB_FMT15(disarmv4t::thumb::instr::InstructionFormat15);
+	template<uint16 bits>
 	void THUMB_FMT16(disarmv4t::thumb::instr::InstructionFormat16);
 	void THUMB_FMT17(disarmv4t::thumb::instr::InstructionFormat17);
 	void THUMB_FMT18(disarmv4t::thumb::instr::InstructionFormat18);
+	template<uint16 bits>
 	void THUMB_FMT19(disarmv4t::thumb::instr::InstructionFormat19);
+	template<uint16 bits>
 	void THUMB_ALU(disarmv4t::thumb::instr::InstructionFormat4);
 	void THUMB_AND(disarmv4t::thumb::instr::InstructionFormat4);
 	void THUMB_EOR(disarmv4t::thumb::instr::InstructionFormat4);
@@ -279,6 +364,36 @@ protected:
 	uint32 mem_read_arm_opcode(uint32 address) const;
 	uint16 mem_read_thumb_opcode(uint32 address) const;
 
+	/*  ==============================================
+	 *                  Block cache
+	 *  ==============================================
+	 */
+	/*
+	 *  Position of the next expected instruction within the last block executed.
+	 *  Sequential execution walks the block without any lookups.
+	 */
+	template<typename Handler>
+	struct BlockCursor {
+		typename BlockCache<Handler>::Block* block { nullptr };
+		size_t index { 0 };
+	};
+
+	static constexpr size_t max_block_length = 64;
+	BlockCache<ArmHandler> m_arm_blocks;
+	BlockCache<ThumbHandler> m_thumb_blocks;
+	BlockCursor<ArmHandler> m_arm_cursor;
+	BlockCursor<ThumbHandler> m_thumb_cursor;
+
+	bool is_cacheable(uint32 address) const;
+	bool execute_cached(uint32 address);
+	template<typename Handler>
+	typename BlockCache<Handler>::Entry const& cached_entry(BlockCache<Handler>&, BlockCursor<Handler>&, uint32 address);
+	void build_block(BlockCache<ArmHandler>::Block&);
+	void build_block(BlockCache<ThumbHandler>::Block&);
+	void clear_block_cache();
+
+	Dynarec m_dynarec;
+
 	/*  ==============================================
 	 *                      DMA
 	 *  ==============================================
@@ -288,6 +403,8 @@ protected:
 	template<unsigned x>
 	void dma_run();
 	template<unsigned x>
+	unsigned dma_run_bulk(DMAx<x>&, bool size_flag, AccessType& type);
+	template<unsigned x>
 	bool dma_is_running();
 	void dma_run_all();
 
@@ -296,16 +413,33 @@ protected:
 	 *  ==============================================
 	 */
 	template<unsigned timer_num>
-	void timers_cycle_n(Timer<timer_num>& timer, size_t n);
+	uint16 timers_counter(Timer<timer_num> const& timer) const;
 	template<unsigned timer_num>
-	void timers_increment(Timer<timer_num>& timer);
-	void timers_cycle_all(size_t n);
+	void timers_schedule_overflow(Timer<timer_num> const& timer);
+	template<unsigned timer_num>
+	void timers_overflow(Timer<timer_num>& timer, uint64 timestamp);
+	template<unsigned timer_num>
+	void timers_increment(Timer<timer_num>& timer, uint64 timestamp);
 
 	unsigned run_to_next_state();
 public:
 	ARM7TDMI(GaBber& emu);
 
 	void reset();
+	void hle_boot();
+	//  SWIs that can be handled natively, all of them are needed to boot without a BIOS
+	static uint64 hle_supported_swis();
+	//  Must be called whenever the bus mapping or the read breakpoints change
+	void invalidate_fetch_window() {
+		m_fetch_window = {};
+		m_dynarec.clear();
+	}
+	template<unsigned timer_num>
+	uint16 on_timer_counter_read();
+	template<unsigned timer_num>
+	void on_timer_control_write(uint16 value);
+	template<unsigned timer_num>
+	void on_timer_overflow(uint64 timestamp);
 	unsigned run_next_instruction();
 
 	void raise_irq(IRQType);
@@ -0,0 +1,164 @@
+#include "Bus/Common/BusInterface.hpp"
+#include "CPU/ARM7TDMI.hpp"
+#include "Debugger/Debugger.hpp"
+#include "Emulator/Config.hpp"
+
+/*
+ *  Only code running from host-backed memory is cached. Writable memory must
+ *  provide a code tracker, so that modified code can be detected.
+ */
+bool ARM7TDMI::is_cacheable(uint32 address) const {
+	auto const* mapping = bus().host_mapping(address);
+	if(!mapping || !(mapping->access & HostRead)) {
+		return false;
+	}
+	const bool writable = mapping->access & (HostWrite | HostWriteByte);
+	return !writable || (mapping->tracker && mapping->tracker->tracks_code());
+}
+
+static bool arm_ends_block(uint32 opcode) {
+	using disarmv4t::arm::InstructionType;
+	const auto rd = (opcode >> 12u) & 0xfu;
+	switch(disarmv4t::arm::decode_fast(opcode)) {
+		case InstructionType::ALU:
+		case InstructionType::SDT:
+		case InstructionType::HDT: return rd == 15;
+		case InstructionType::BDT: return opcode & (1u << 15u);
+		case InstructionType::MUL:
+		case InstructionType::MLL:
+		case InstructionType::SWP: return false;
+		default: return true;
+	}
+}
+
+static bool thumb_ends_block(uint16 opcode) {
+	using disarmv4t::thumb::InstructionType;
+	switch(disarmv4t::thumb::decode(opcode)) {
+		case InstructionType::FMT5: {
+			const auto op = (opcode >> 8u) & 3u;
+			const auto rd = ((opcode >> 4u) & 8u) | (opcode & 7u);
+			return op == 3 || (op != 1 && rd == 15);
+		}
+		//  POP {.., pc}
+		case InstructionType::FMT14: return (opcode & 0x0900) == 0x0900;
+		case InstructionType::FMT16:
+		case InstructionType::FMT17:
+		case InstructionType::FMT18:
+		case InstructionType::FMT19:
+		case InstructionType::UD:
+		case InstructionType::UD9:
+		case InstructionType::BKPT:
+		case InstructionType::BLX9:
+		case InstructionType::_end: return true;
+		default: return false;
+	}
+}
+
+void ARM7TDMI::build_block(BlockCache<ArmHandler>::Block& block) {
+	auto const* mapping = bus().host_mapping(block.start);
+	block.generation = bus().track_code(block.start);
+	block.generation_snapshot = block.generation ? *block.generation : 0;
+
+	//  Blocks in tracked memory must not outgrow the chunk of their generation
+	const uint32 granule = block.generation ? CodeTracker::chunk_size : BusInterface::page_size;
+	const uint32 region = block.start / granule;
+	for(uint32 address = block.start;
+	    address / granule == region && block.entries.size() < max_block_length; address += 4) {
+		const auto opcode = *reinterpret_cast<uint32 const*>(mapping->base + (address & mapping->mask));
+		const auto type = disarmv4t::arm::decode_fast(opcode);
+		block.entries.push_back({ s_arm_handlers[static_cast<size_t>(type)], opcode });
+		if(arm_ends_block(opcode)) {
+			break;
+		}
+	}
+}
+
+void ARM7TDMI::build_block(BlockCache<ThumbHandler>::Block& block) {
+	auto const* mapping = bus().host_mapping(block.start);
+	block.generation = bus().track_code(block.start);
+	block.generation_snapshot = block.generation ? *block.generation : 0;
+
+	//  Blocks in tracked memory must not outgrow the chunk of their generation
+	const uint32 granule = block.generation ? CodeTracker::chunk_size : BusInterface::page_size;
+	const uint32 region = block.start / granule;
+	for(uint32 address = block.start;
+	    address / granule == region && block.entries.size() < max_block_length; address += 2) {
+		const auto opcode = *reinterpret_cast<uint16 const*>(mapping->base + (address & mapping->mask));
+		block.entries.push_back({ s_thumb_handlers[opcode >> 6u], opcode });
+		if(thumb_ends_block(opcode)) {
+			break;
+		}
+	}
+}
+
+template<typename Handler>
+typename BlockCache<Handler>::Entry const& ARM7TDMI::cached_entry(BlockCache<Handler>& cache,
+                                                                 BlockCursor<Handler>& cursor, uint32 address) {
+	auto* block = cursor.block;
+	const bool sequential = block && cursor.index < block->entries.size() &&
+	                        block->start + cursor.index * current_instr_len() == address;
+	if(!sequential) {
+		block = cache.find(address);
+		cursor.index = 0;
+	}
+
+	//  A write to the page the block was decoded from may have modified it,
+	//  decode a fresh block starting at the current instruction
+	if(!block || block->is_stale()) {
+		block = &cache.insert(address);
+		build_block(*block);
+		cursor.index = 0;
+	}
+
+	cursor.block = block;
+	return block->entries[cursor.index++];
+}
+
+bool ARM7TDMI::execute_cached(uint32 address) {
+	if(!config().cpu_block_cache) {
+		return false;
+	}
+	if(debugger().is_armed(address, BreakRead) || debugger().is_armed(address, BreakExec)) {
+		return false;
+	}
+	if(!is_cacheable(address)) {
+		return false;
+	}
+
+	if(cspr().state() == INSTR_MODE::ARM) {
+		auto entry = cached_entry(m_arm_blocks, m_arm_cursor, address);
+		if(config().cpu_block_cache_verify) {
+			const auto opcode = mem_read_arm_opcode(address);
+			if(opcode != entry.opcode) {
+				log("Block cache mismatch at {:08x}: cached={:08x}, memory={:08x}", address, entry.opcode, opcode);
+				auto& block = m_arm_blocks.insert(address);
+				build_block(block);
+				m_arm_cursor = { &block, 1 };
+				entry = block.entries.front();
+			}
+		}
+		(this->*entry.handler)(entry.opcode);
+	} else {
+		auto entry = cached_entry(m_thumb_blocks, m_thumb_cursor, address);
+		if(config().cpu_block_cache_verify) {
+			const auto opcode = mem_read_thumb_opcode(address);
+			if(opcode != entry.opcode) {
+				log("Block cache mismatch at {:08x}: cached={:04x}, memory={:04x}", address, entry.opcode, opcode);
+				auto& block = m_thumb_blocks.insert(address);
+				build_block(block);
+				m_thumb_cursor = { &block, 1 };
+				entry = block.entries.front();
+			}
+		}
+		(this->*entry.handler)(static_cast<uint16>(entry.opcode));
+	}
+
+	return true;
+}
+
+void ARM7TDMI::clear_block_cache() {
+	m_arm_blocks.clear();
+	m_thumb_blocks.clear();
+	m_arm_cursor = {};
+	m_thumb_cursor = {};
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "Emulator/StdTypes.hpp"
+
+/*
+ *  Cache of pre-decoded instructions, grouped into blocks of straight-line code
+ *  starting at a given address. Blocks taken from writable memory remember the
+ *  write generation of the 256-byte chunk they were decoded from, and become
+ *  stale once the chunk is written to.
+ */
+template<typename Handler>
+class BlockCache {
+public:
+	struct Entry {
+		Handler handler;
+		uint32 opcode;
+	};
+
+	struct Block {
+		uint32 start { 0 };
+		uint32 const* generation { nullptr };
+		uint32 generation_snapshot { 0 };
+		std::vector<Entry> entries {};
+
+		bool is_stale() const { return generation && *generation != generation_snapshot; }
+	};
+
+	Block* find(uint32 address) {
+		auto it = m_blocks.find(address);
+		if(it == m_blocks.end()) {
+			return nullptr;
+		}
+		return &it->second;
+	}
+
+	Block& insert(uint32 address) {
+		auto& block = m_blocks[address];
+		block.start = address;
+		block.generation = nullptr;
+		block.generation_snapshot = 0;
+		block.entries.clear();
+		return block;
+	}
+
+	void clear() { m_blocks.clear(); }
+private:
+	std::unordered_map<uint32, Block> m_blocks;
+};
@@ -4,50 +4,66 @@
 
 uint8 ARM7TDMI::mem_read8(uint32 address) const {
 	auto v = bus().read8(address);
-	debugger().on_memory_access(address, (uint8)v, false);
+	if(debugger().is_armed(address, BreakRead)) {
+		debugger().on_memory_access(address, (uint8)v, false);
+	}
 
 	return v;
 }
 
 uint16 ARM7TDMI::mem_read16(uint32 address) const {
 	auto v = bus().read16(address);
-	debugger().on_memory_access(address, (uint16)v, false);
+	if(debugger().is_armed(address, BreakRead)) {
+		debugger().on_memory_access(address, (uint16)v, false);
+	}
 
 	return v;
 }
 
 uint32 ARM7TDMI::mem_read32(uint32 address) const {
 	auto v = bus().read32(address);
-	debugger().on_memory_access(address, (uint32)v, false);
+	if(debugger().is_armed(address, BreakRead)) {
+		debugger().on_memory_access(address, (uint32)v, false);
+	}
 
 	return v;
 }
 
 void ARM7TDMI::mem_write8(uint32 address, uint8 val) {
-	debugger().on_memory_access(address, (uint8)val, true);
+	if(debugger().is_armed(address, BreakWrite)) {
+		debugger().on_memory_access(address, (uint8)val, true);
+	}
 	bus().write8(address, val);
 }
 
 void ARM7TDMI::mem_write16(uint32 address, uint16 val) {
-	debugger().on_memory_access(address, (uint16)val, true);
+	if(debugger().is_armed(address, BreakWrite)) {
+		debugger().on_memory_access(address, (uint16)val, true);
+	}
 	bus().write16(address, val);
 }
 
 void ARM7TDMI::mem_write32(uint32 address, uint32 val) {
-	debugger().on_memory_access(address, (uint32)val, true);
+	if(debugger().is_armed(address, BreakWrite)) {
+		debugger().on_memory_access(address, (uint32)val, true);
+	}
 	bus().write32(address, val);
 }
 
 uint32 ARM7TDMI::mem_read_arm_opcode(uint32 address) const {
 	auto v = bus().read32(address);
-	debugger().on_memory_access(address, (uint32)v, false);
+	if(debugger().is_armed(address, BreakRead)) {
+		debugger().on_memory_access(address, (uint32)v, false);
+	}
 
 	return v;
 }
 
 uint16 ARM7TDMI::mem_read_thumb_opcode(uint32 address) const {
 	auto v = bus().read16(address);
-	debugger().on_memory_access(address, (uint16)v, false);
+	if(debugger().is_armed(address, BreakRead)) {
+		debugger().on_memory_access(address, (uint16)v, false);
+	}
 
 	return v;
 }
@@ -1,7 +1,10 @@
 #include "Bus/IO/DMA.hpp"
+#include <algorithm>
+#include <cstring>
 #include "Bus/Common/BusInterface.hpp"
 #include "Bus/IO/IOContainer.hpp"
 #include "CPU/ARM7TDMI.hpp"
+#include "Debugger/Debugger.hpp"
 
 void ARM7TDMI::dma_run_all() {
 	if(dma_is_running<0>()) {
@@ -31,12 +34,17 @@ void ARM7TDMI::dma_run() {
 	}
 
 	//  In FIFO mode, a 32-bit transfer is forced
-	const bool size_flag =
-	        (s.m_ctrl->start_timing == DMAStartTiming::Special && (x == 1 || x == 2)) ? true : s.m_ctrl->transfer_size;
+	const bool fifo = s.m_ctrl->start_timing == DMAStartTiming::Special && (x == 1 || x == 2);
+	const bool size_flag = fifo ? true : s.m_ctrl->transfer_size;
 
 	AccessType type { AccessType::NonSeq };
 
-	while(s.m_count--) {
+	while(s.m_count) {
+		if(!fifo && dma_run_bulk(s, size_flag, type) != 0) {
+			continue;
+		}
+
+		s.m_count--;
 		const uint32 data = (size_flag) ? mem_read32(s.m_source_ptr) : mem_read16(s.m_source_ptr);
 		if(size_flag) {
 			mem_write32(s.m_destination_ptr, data);
@@ -62,7 +70,7 @@ void ARM7TDMI::dma_run() {
 			s.m_source_ptr -= size_flag ? 4 : 2;
 
 		//  Destination address is not incremented in FIFO mode
-		if(s.m_ctrl->start_timing == DMAStartTiming::Special && (x == 1 || x == 2)) {
+		if(fifo) {
 			continue;
 		}
 
@@ -91,6 +99,82 @@ void ARM7TDMI::dma_run() {
 	}
 }
 
+/*
+ *  Moves as many units as possible in one step while both sides of the
+ *  transfer are plain host memory. Returns the amount of units transferred,
+ *  or 0 if the next unit has to go through the bus.
+ */
+template<unsigned x>
+unsigned ARM7TDMI::dma_run_bulk(DMAx<x>& s, bool size_flag, AccessType& type) {
+	const DMASrcCtrl src_ctl = s.m_ctrl->src_ctl;
+	const DMADestCtrl dest_ctl = s.m_ctrl->dest_ctl;
+	if(src_ctl != DMASrcCtrl::Increment && src_ctl != DMASrcCtrl::Fixed) {
+		return 0;
+	}
+	if(dest_ctl != DMADestCtrl::Increment && dest_ctl != DMADestCtrl::Reload) {
+		return 0;
+	}
+
+	const uint32 unit = size_flag ? 4 : 2;
+	const uint32 source = s.m_source_ptr & ~(unit - 1);
+	const uint32 destination = s.m_destination_ptr & ~(unit - 1);
+	if(debugger().is_armed(source, BreakRead) || debugger().is_armed(destination, BreakWrite)) {
+		return 0;
+	}
+
+	const auto src = bus().host_span(source, HostRead);
+	if(!src.data) {
+		return 0;
+	}
+	const auto dst = bus().host_span(destination, HostWrite, s.m_count * unit);
+	if(!dst.data) {
+		return 0;
+	}
+
+	uint32 count = std::min<uint32>(s.m_count, dst.size / unit);
+	if(src_ctl == DMASrcCtrl::Increment) {
+		count = std::min(count, src.size / unit);
+	}
+	if(count == 0) {
+		return 0;
+	}
+
+	const uint32 bytes = count * unit;
+	if(src_ctl == DMASrcCtrl::Fixed) {
+		uint8 value[4];
+		std::memcpy(value, src.data, unit);
+		if(std::all_of(value, value + unit, [&value](uint8 byte) { return byte == value[0]; })) {
+			std::memset(dst.data, value[0], bytes);
+		} else {
+			for(uint32 offset = 0; offset < bytes; offset += unit) {
+				std::memcpy(dst.data + offset, value, unit);
+			}
+		}
+	} else if(dst.data >= src.data + bytes || src.data >= dst.data + bytes) {
+		std::memcpy(dst.data, src.data, bytes);
+	} else {
+		//  Overlapping transfers must behave like a sequence of single units
+		for(uint32 offset = 0; offset < bytes; offset += unit) {
+			std::memmove(dst.data + offset, src.data + offset, unit);
+		}
+	}
+	bus().host_written(destination, bytes);
+
+	auto waits = [this, size_flag](uint32 address, AccessType access) {
+		return size_flag ? mem_waits_access32(address, access) : mem_waits_access16(address, access);
+	};
+	m_wait_cycles += waits(source, type) + waits(destination, type) +
+	                 (count - 1) * (waits(source, AccessType::Seq) + waits(destination, AccessType::Seq));
+	type = AccessType::Seq;
+
+	if(src_ctl == DMASrcCtrl::Increment) {
+		s.m_source_ptr += bytes;
+	}
+	s.m_destination_ptr += bytes;
+	s.m_count -= count;
+	return count;
+}
+
 /*
  *  When the enable bit is toggled, the internal registers (SAD, DAD, CNT_L) are reloaded.
  */
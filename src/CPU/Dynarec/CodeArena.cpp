@@ -0,0 +1,48 @@
+#include "CPU/Dynarec/CodeArena.hpp"
+#include <cstring>
+#include <fmt/format.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+CodeArena::~CodeArena() {
+	if(m_base) {
+		munmap(m_base, m_size);
+	}
+}
+
+bool CodeArena::map() {
+	void* base = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(base == MAP_FAILED) {
+		fmt::print("CodeArena: Failed mapping {} bytes for recompiled code\n", m_size);
+		m_failed = true;
+		return false;
+	}
+	m_base = static_cast<uint8*>(base);
+	return true;
+}
+
+void const* CodeArena::allocate(uint8 const* code, size_t size) {
+	if(!m_base && (m_failed || !map())) {
+		return nullptr;
+	}
+
+	//  Keep every block aligned to a cache line
+	const size_t start = (m_used + 63) & ~size_t(63);
+	if(start + size > m_size) {
+		return nullptr;
+	}
+
+	static const size_t page_size = sysconf(_SC_PAGESIZE);
+	const size_t first_page = start & ~(page_size - 1);
+	const size_t end_page = (start + size + page_size - 1) & ~(page_size - 1);
+	if(mprotect(m_base + first_page, end_page - first_page, PROT_READ | PROT_WRITE) != 0) {
+		return nullptr;
+	}
+	std::memcpy(m_base + start, code, size);
+	if(mprotect(m_base + first_page, end_page - first_page, PROT_READ | PROT_EXEC) != 0) {
+		return nullptr;
+	}
+
+	m_used = start + size;
+	return m_base + start;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "Emulator/StdTypes.hpp"
+
+/*
+ *  Memory region holding recompiled code. Nothing is mapped until the first
+ *  allocation, so the arena costs nothing while the recompiler is disabled.
+ *  Pages are never writable and executable at the same time: they are made
+ *  writable only while code is copied into them, and executable afterwards.
+ *  Allocations are never freed individually, the whole arena is reset once
+ *  it runs out of space.
+ */
+class CodeArena {
+	uint8* m_base { nullptr };
+	size_t m_size { 0 };
+	size_t m_used { 0 };
+	bool m_failed { false };
+
+	bool map();
+public:
+	explicit CodeArena(size_t size)
+	    : m_size(size) {}
+	~CodeArena();
+	CodeArena(CodeArena const&) = delete;
+	CodeArena& operator=(CodeArena const&) = delete;
+
+	bool is_mapped() const { return m_base != nullptr; }
+	//  Returns nullptr if the arena is full or could not be mapped
+	void const* allocate(uint8 const* code, size_t size);
+	void reset() { m_used = 0; }
+};
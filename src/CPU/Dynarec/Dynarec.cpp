@@ -0,0 +1,289 @@
+#include "CPU/Dynarec/Dynarec.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "Bus/Common/BusDevice.hpp"
+#include "Bus/Common/BusInterface.hpp"
+#include "CPU/ARM7TDMI.hpp"
+#include "CPU/Dynarec/Translator.hpp"
+#include "Debugger/Debugger.hpp"
+#include "Emulator/Bits.hpp"
+#include "Emulator/Config.hpp"
+#include "Emulator/GaBber.hpp"
+
+//  The generated code follows the System V x86-64 calling convention
+#if defined(__x86_64__) && defined(__linux__)
+static constexpr bool host_supported = true;
+#else
+static constexpr bool host_supported = false;
+#endif
+
+Dynarec::Dynarec(GaBber& emu)
+    : Module(emu) {}
+
+bool Dynarec::execute() {
+	if(!host_supported || debugger().is_debug_mode() || debugger().has_breakpoints()) {
+		return false;
+	}
+
+	auto& cpu = this->cpu();
+	const bool thumb = cpu.cspr().state() == INSTR_MODE::THUMB;
+	const uint32 address = cpu.const_pc() - 2 * cpu.current_instr_len();
+	auto const* block = find_or_compile(address, thumb);
+	if(!block) {
+		return false;
+	}
+
+	const uint32 result = m_lockstep ? run_lockstep(*block, address) : run(*block);
+	if((result & exit_taken) && config().cpu_idle_loop_skip) {
+		cpu.idle_loop_check(address + ((result & exit_count_mask) - 1) * cpu.current_instr_len());
+	}
+	return true;
+}
+
+void Dynarec::clear() {
+	m_blocks.clear();
+	m_arena.reset();
+}
+
+Dynarec::CompiledBlock const* Dynarec::find_or_compile(uint32 address, bool thumb) {
+	//  Compiled code has the wait states of its instruction fetches built in
+	if(bus().wait_generation() != m_wait_generation || config().cpu_dynarec_lockstep != m_lockstep) {
+		clear();
+		m_wait_generation = bus().wait_generation();
+		m_lockstep = config().cpu_dynarec_lockstep;
+		refresh_data_waits();
+	}
+
+	const uint32 key = address | (thumb ? 1u : 0u);
+	if(auto it = m_blocks.find(key); it != m_blocks.end() && !it->second.is_stale()) {
+		return it->second.code ? &it->second : nullptr;
+	}
+	if(!cpu().is_cacheable(address)) {
+		return nullptr;
+	}
+
+	CompiledBlock block {};
+	block.generation = bus().track_code(address);
+	block.generation_snapshot = block.generation ? *block.generation : 0;
+
+	const auto code = Translator(m_emu, *this, address, thumb, m_lockstep).translate();
+	if(!code.empty()) {
+		auto const* host = m_arena.allocate(code.data(), code.size());
+		if(!host && m_arena.is_mapped()) {
+			//  Out of space, start over with an empty arena
+			clear();
+			host = m_arena.allocate(code.data(), code.size());
+		}
+		block.code = reinterpret_cast<BlockFunction>(const_cast<void*>(host));
+	}
+
+	auto const& entry = m_blocks[key] = block;
+	return entry.code ? &entry : nullptr;
+}
+
+void Dynarec::refresh_data_waits() {
+	for(unsigned index = 0; index < 256; ++index) {
+		const uint32 address = index << 24u;
+		m_data_waits[0][index] = bus().waits8(address, AccessType::NonSeq);
+		m_data_waits[1][index] = bus().waits16(address, AccessType::NonSeq);
+		m_data_waits[2][index] = bus().waits32(address, AccessType::NonSeq);
+	}
+}
+
+uint32 Dynarec::run(CompiledBlock const& block) {
+	auto& cpu = this->cpu();
+	const uint32 psr = cpu.cspr().raw();
+	m_flags = ((psr >> 16u) & 0xc000u) | ((psr >> 21u) & 0x100u) | ((psr >> 28u) & 1u);
+	const uint64 budget = static_cast<uint64>(cpu.m_wait_cycles) + cpu.cycles_to_next_event();
+	m_budget = static_cast<uint32>(std::min<uint64>(budget, std::numeric_limits<uint32>::max()));
+	m_exit = Continue;
+
+	const uint32 result = block.code(&cpu);
+
+	const uint32 nzcv = ((m_flags & 0xc000u) << 16u) | ((m_flags & 0x100u) << 21u) | ((m_flags & 1u) << 28u);
+	cpu.cspr().set_flags((cpu.cspr().raw() & 0x0fffffffu) | nzcv, true, false, false, false);
+	return result;
+}
+
+/*
+ *  Runs the block, then undoes it and runs the same instructions through the
+ *  interpreter. The interpreter's state is kept, and the interpreter already
+ *  checked for idle loops, so the taken flag is dropped from the result.
+ */
+uint32 Dynarec::run_lockstep(CompiledBlock const& block, uint32 address) {
+	auto& cpu = this->cpu();
+	const auto before = take_snapshot();
+	m_journal.clear();
+	m_unverifiable = false;
+
+	const uint32 result = run(block);
+	if(m_unverifiable) {
+		return result;
+	}
+
+	const auto compiled = take_snapshot();
+	std::vector<std::array<uint8, 4>> written(m_journal.size());
+	for(size_t i = 0; i < m_journal.size(); ++i) {
+		std::memcpy(written[i].data(), bus().host_span(m_journal[i].address, HostRead).data, 4);
+	}
+	//  Newest first, so that the oldest contents win for repeated addresses
+	for(auto it = m_journal.rbegin(); it != m_journal.rend(); ++it) {
+		std::memcpy(bus().host_span(it->address, HostRead).data, it->bytes.data(), it->bytes.size());
+		bus().host_written(it->address, it->bytes.size());
+	}
+
+	restore_snapshot(before);
+	const unsigned count = result & exit_count_mask;
+	for(unsigned i = 0; i < count; ++i) {
+		cpu.exec_opcode();
+	}
+
+	bool match = compare_snapshots(compiled, take_snapshot(), address);
+	for(size_t i = 0; i < m_journal.size(); ++i) {
+		auto const* memory = bus().host_span(m_journal[i].address, HostRead).data;
+		if(std::memcmp(memory, written[i].data(), 4) != 0) {
+			uint32 expected, actual;
+			std::memcpy(&expected, written[i].data(), 4);
+			std::memcpy(&actual, memory, 4);
+			cpu.log("Dynarec lockstep mismatch in block {:08x}: [{:08x}] compiled={:08x} interpreted={:08x}", address,
+			        m_journal[i].address, expected, actual);
+			match = false;
+		}
+	}
+	if(!match) {
+		m_emu.enter_debug_mode();
+	}
+	return count;
+}
+
+Dynarec::Snapshot Dynarec::take_snapshot() const {
+	auto const& cpu = this->cpu();
+	return { cpu.m_registers, cpu.m_status, cpu.m_wait_cycles, cpu.m_timer_polled };
+}
+
+void Dynarec::restore_snapshot(Snapshot const& snapshot) {
+	auto& cpu = this->cpu();
+	cpu.m_registers = snapshot.registers;
+	cpu.m_status = snapshot.status;
+	cpu.m_wait_cycles = snapshot.wait_cycles;
+	cpu.m_timer_polled = snapshot.timer_polled;
+}
+
+bool Dynarec::compare_snapshots(Snapshot const& compiled, Snapshot const& interpreted, uint32 address) const {
+	auto const& cpu = this->cpu();
+	bool match = true;
+	auto check = [&](const char* name, unsigned index, uint32 a, uint32 b) {
+		if(a != b) {
+			cpu.log("Dynarec lockstep mismatch in block {:08x}: {}{} compiled={:08x} interpreted={:08x}", address, name,
+			        index, a, b);
+			match = false;
+		}
+	};
+
+	for(unsigned i = 0; i < 16; ++i) {
+		check("r", i, compiled.registers.m_active[i], interpreted.registers.m_active[i]);
+	}
+	check("cpsr", 0, compiled.status.raw(), interpreted.status.raw());
+	check("wait cycles", 0, compiled.wait_cycles, interpreted.wait_cycles);
+	return match;
+}
+
+/*  ==============================================
+ *                Runtime helpers
+ *  ==============================================
+ */
+void const* Dynarec::slow_path(Access access) {
+	switch(access) {
+		case Access::Load32: return reinterpret_cast<void const*>(&load_slow<Access::Load32>);
+		case Access::Load16: return reinterpret_cast<void const*>(&load_slow<Access::Load16>);
+		case Access::LoadS16: return reinterpret_cast<void const*>(&load_slow<Access::LoadS16>);
+		case Access::Load8: return reinterpret_cast<void const*>(&load_slow<Access::Load8>);
+		case Access::LoadS8: return reinterpret_cast<void const*>(&load_slow<Access::LoadS8>);
+		case Access::Store32: return reinterpret_cast<void const*>(&store_slow<Access::Store32>);
+		case Access::Store16: return reinterpret_cast<void const*>(&store_slow<Access::Store16>);
+		case Access::Store8: return reinterpret_cast<void const*>(&store_slow<Access::Store8>);
+		default: return nullptr;
+	}
+}
+
+/*
+ *  Accesses to I/O see the current time, e.g. timer counters and VCOUNT. The
+ *  interpreter runs the scheduler between instructions, so such an access
+ *  has to start a new block when it is not the first instruction.
+ */
+template<Dynarec::Access access>
+uint32 Dynarec::load_slow(ARM7TDMI* cpu, uint32 address, uint32 first) {
+	auto& self = cpu->m_dynarec;
+	if(observes_time(address) && !first) {
+		self.m_exit = ExitBefore;
+		return 0;
+	}
+	if(self.m_lockstep) {
+		//  Reads with side effects cannot be repeated by the interpreter
+		auto const* mapping = cpu->bus().host_mapping(address);
+		if(!mapping || !(mapping->access & HostRead)) {
+			self.m_unverifiable = true;
+		}
+	}
+
+	if constexpr(access == Access::Load32) {
+		return Bits::rotr32(cpu->mem_read32(address & ~3u), (address & 3u) * 8);
+	} else if constexpr(access == Access::Load16) {
+		const uint32 value = cpu->mem_read16(address & ~1u);
+		return (address & 1u) ? Bits::rotr32(value, 8) : value;
+	} else if constexpr(access == Access::LoadS16) {
+		return (address & 1u) ? Bits::sign_extend<8>(cpu->mem_read8(address))
+		                      : Bits::sign_extend<16>(cpu->mem_read16(address));
+	} else if constexpr(access == Access::Load8) {
+		return cpu->mem_read8(address);
+	} else {
+		return Bits::sign_extend<8>(cpu->mem_read8(address));
+	}
+}
+
+template<Dynarec::Access access>
+void Dynarec::store_slow(ARM7TDMI* cpu, uint32 address, uint32 value, uint32 first) {
+	auto& self = cpu->m_dynarec;
+	if(observes_time(address)) {
+		if(!first) {
+			self.m_exit = ExitBefore;
+			return;
+		}
+		//  I/O writes can raise interrupts, start DMAs or halt the CPU
+		self.m_exit = ExitAfter;
+	}
+	if(self.m_lockstep) {
+		self.record_store(address);
+	}
+
+	if constexpr(access == Access::Store32) {
+		cpu->mem_write32(address & ~3u, value);
+	} else if constexpr(access == Access::Store16) {
+		cpu->mem_write16(address & ~1u, value);
+	} else {
+		cpu->mem_write8(address, value);
+	}
+}
+
+void Dynarec::record_store(uint32 address) {
+	auto const* mapping = bus().host_mapping(address);
+	if(!mapping || !(mapping->access & HostRead)) {
+		m_unverifiable = true;
+		return;
+	}
+	journal_store(&cpu(), address);
+}
+
+void Dynarec::code_written(ARM7TDMI* cpu, uint32 address, uint32 size) {
+	//  The block may have overwritten its own code, which is stale from now on
+	cpu->bus().host_written(address & ~(size - 1), size);
+	cpu->m_dynarec.m_exit = ExitAfter;
+}
+
+void Dynarec::journal_store(ARM7TDMI* cpu, uint32 address) {
+	const uint32 aligned = address & ~3u;
+	JournalEntry entry { aligned, {} };
+	std::memcpy(entry.bytes.data(), cpu->bus().host_span(aligned, HostRead).data, entry.bytes.size());
+	cpu->m_dynarec.m_journal.push_back(entry);
+}
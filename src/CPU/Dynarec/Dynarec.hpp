@@ -0,0 +1,131 @@
+#pragma once
+#include <array>
+#include <unordered_map>
+#include <vector>
+#include "CPU/Dynarec/CodeArena.hpp"
+#include "CPU/GPR.hpp"
+#include "CPU/PSR.hpp"
+#include "Emulator/Module.hpp"
+#include "Emulator/StdTypes.hpp"
+
+/*
+ *  Recompiles guest basic blocks into x86-64 host code, see Translator for
+ *  the code that is generated. Blocks run until they branch, reach an
+ *  instruction the translator does not support, write to I/O or to their own
+ *  code, or use up the cycles left until the next scheduler event. Every
+ *  instruction adds the same wait cycles as in the interpreter.
+ *
+ *  In lockstep mode, every block is run a second time by the interpreter from
+ *  the same starting state, and the registers, flags, wait cycles and written
+ *  memory of both runs are compared.
+ */
+class Dynarec : Module {
+	friend class Translator;
+
+	//  Compiled blocks return the number of guest instructions they ran, plus
+	//  exit_taken if the last one was a taken branch
+	using BlockFunction = uint32 (*)(ARM7TDMI*);
+	static constexpr uint32 exit_taken = 1u << 8u;
+	static constexpr uint32 exit_count_mask = exit_taken - 1;
+
+	//  Requests from the runtime helpers to leave the block
+	enum ExitRequest : uint8 {
+		Continue = 0,
+		//  After the current instruction, e.g. when it wrote to I/O
+		ExitAfter = 1,
+		//  Before the current instruction, which has not changed any state yet
+		ExitBefore = 2,
+	};
+
+	enum class Access : uint8 {
+		Load32,
+		Load16,
+		LoadS16,
+		Load8,
+		LoadS8,
+		Store32,
+		Store16,
+		Store8,
+	};
+
+	struct CompiledBlock {
+		BlockFunction code { nullptr };
+		uint32 const* generation { nullptr };
+		uint32 generation_snapshot { 0 };
+
+		bool is_stale() const { return generation && *generation != generation_snapshot; }
+	};
+
+	static constexpr size_t arena_size = 4 * MB;
+	static constexpr size_t max_block_length = 64;
+
+	/*
+	 *  State shared with the compiled code, which addresses it relative to the
+	 *  ARM7TDMI the Dynarec is part of.
+	 */
+	//  NZCV in the layout produced by lahf and seto: N, Z and C in bits 15, 14
+	//  and 8, V in bit 0
+	uint32 m_flags { 0 };
+	//  Value of m_wait_cycles at which the next scheduler event is due
+	uint32 m_budget { 0 };
+	uint8 m_exit { Continue };
+	//  Non-sequential data access waits by log2 of the access width and
+	//  address bits [31:24]
+	std::array<std::array<uint8, 256>, 3> m_data_waits {};
+
+	CodeArena m_arena { arena_size };
+	//  Keyed by the block address, with bit 0 set for THUMB code. Blocks that
+	//  cannot be compiled are cached without code.
+	std::unordered_map<uint32, CompiledBlock> m_blocks;
+	unsigned m_wait_generation { ~0u };
+	bool m_lockstep { false };
+
+	/*
+	 *  Lockstep state. Stores to host memory record the bytes they overwrite,
+	 *  so that they can be undone before the interpreter runs the block again.
+	 *  Blocks which access memory that cannot be undone or read twice are
+	 *  not verified.
+	 */
+	struct JournalEntry {
+		uint32 address;
+		std::array<uint8, 4> bytes;
+	};
+	struct Snapshot {
+		GPR registers;
+		CSPR status;
+		unsigned wait_cycles;
+		bool timer_polled;
+	};
+	std::vector<JournalEntry> m_journal;
+	bool m_unverifiable { false };
+
+	CompiledBlock const* find_or_compile(uint32 address, bool thumb);
+	void refresh_data_waits();
+	uint32 run(CompiledBlock const&);
+	uint32 run_lockstep(CompiledBlock const&, uint32 address);
+	Snapshot take_snapshot() const;
+	void restore_snapshot(Snapshot const&);
+	bool compare_snapshots(Snapshot const& compiled, Snapshot const& interpreted, uint32 address) const;
+
+	static bool observes_time(uint32 address) { return (address >> 24u) == 0x04; }
+	void record_store(uint32 address);
+
+	//  Runtime helper performing the given access through the bus
+	static void const* slow_path(Access);
+	template<Access access>
+	static uint32 load_slow(ARM7TDMI*, uint32 address, uint32 first);
+	template<Access access>
+	static void store_slow(ARM7TDMI*, uint32 address, uint32 value, uint32 first);
+	static void code_written(ARM7TDMI*, uint32 address, uint32 size);
+	static void journal_store(ARM7TDMI*, uint32 address);
+public:
+	Dynarec(GaBber&);
+
+	/*
+	 *  Runs the compiled block at the current PC, compiling it first if needed.
+	 *  Returns false if the code at the PC cannot be recompiled, in which case
+	 *  the caller should interpret the next instruction instead.
+	 */
+	bool execute();
+	void clear();
+};
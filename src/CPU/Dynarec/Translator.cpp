@@ -0,0 +1,1103 @@
+#include "CPU/Dynarec/Translator.hpp"
+#include <algorithm>
+#include <numeric>
+#include "Bus/Common/BusDevice.hpp"
+#include "Bus/Common/BusInterface.hpp"
+#include "CPU/ARM7TDMI.hpp"
+#include "Emulator/Bits.hpp"
+
+using namespace x64;
+namespace arm = disarmv4t::arm::instr;
+namespace thumb = disarmv4t::thumb::instr;
+using disarmv4t::InstructionCondition;
+using disarmv4t::ShiftType;
+
+//  Host registers that cache guest registers, callee-saved ones first
+static constexpr std::array<Reg, 8> s_register_pool { rbp, r12, r13, r14, r8, r9, r10, r11 };
+
+static bool is_caller_saved(Reg reg) {
+	return reg >= r8 && reg <= r11;
+}
+
+template<typename T>
+static int32 offset_of(ARM7TDMI const& cpu, T const& member) {
+	return static_cast<int32>(reinterpret_cast<uint8 const*>(&member) - reinterpret_cast<uint8 const*>(&cpu));
+}
+
+Translator::Translator(GaBber& emu, Dynarec& dynarec, uint32 address, bool thumb, bool lockstep)
+    : Module(emu)
+    , m_dynarec(dynarec)
+    , m_start(address)
+    , m_thumb(thumb)
+    , m_lockstep(lockstep) {
+	auto const& cpu = this->cpu();
+	m_registers_offset = offset_of(cpu, cpu.m_registers.m_active);
+	m_wait_cycles_offset = offset_of(cpu, cpu.m_wait_cycles);
+	m_flags_offset = offset_of(cpu, m_dynarec.m_flags);
+	m_budget_offset = offset_of(cpu, m_dynarec.m_budget);
+	m_exit_offset = offset_of(cpu, m_dynarec.m_exit);
+	m_data_waits_offset = offset_of(cpu, m_dynarec.m_data_waits);
+	m_host.fill(rsp);
+
+	//  EWRAM and IWRAM, the only writable memory code commonly runs from
+	for(const uint32 index : { 0x02u, 0x03u }) {
+		auto const* mapping = bus().host_mapping(index << 24u);
+		const unsigned access = HostRead | HostWrite | HostWriteByte;
+		if(!mapping || (mapping->access & access) != access || !mapping->tracker ||
+		   !mapping->tracker->code_bitmap()) {
+			continue;
+		}
+		m_regions.push_back({ index, mapping, mapping->tracker->code_bitmap() });
+	}
+}
+
+std::vector<uint8> Translator::translate() {
+	if(!scan()) {
+		return {};
+	}
+
+	//  The first pass only counts how often every guest register is used
+	emit_block();
+	allocate_registers();
+	emit_block();
+	if(!m_code.finish()) {
+		return {};
+	}
+	return m_code.code();
+}
+
+/*
+ *  Collects the opcodes of the block, under the same limits as the block cache.
+ */
+bool Translator::scan() {
+	auto const* mapping = bus().host_mapping(m_start);
+	if(!mapping || !(mapping->access & HostRead)) {
+		return false;
+	}
+
+	const bool tracked = mapping->tracker && mapping->tracker->tracks_code();
+	const uint32 granule = tracked ? CodeTracker::chunk_size : BusInterface::page_size;
+	const uint32 region = m_start / granule;
+	for(uint32 address = m_start; address / granule == region && m_opcodes.size() < Dynarec::max_block_length;
+	    address += len()) {
+		auto const* host = mapping->base + (address & mapping->mask);
+		const uint32 opcode =
+		        m_thumb ? *reinterpret_cast<uint16 const*>(host) : *reinterpret_cast<uint32 const*>(host);
+		if(!(m_thumb ? thumb_supported(opcode) : arm_supported(opcode))) {
+			break;
+		}
+		m_opcodes.push_back(opcode);
+		if(m_thumb ? thumb_ends_block(opcode) : arm_ends_block(opcode)) {
+			break;
+		}
+	}
+	return !m_opcodes.empty();
+}
+
+bool Translator::arm_supported(uint32 opcode) const {
+	using disarmv4t::arm::InstructionType;
+	switch(disarmv4t::arm::decode_fast(opcode)) {
+		case InstructionType::BBL: return true;
+		case InstructionType::ALU: {
+			const arm::DataProcessInstruction instr(opcode);
+			const bool psr_transfer = instr.opcode() >= 8 && instr.opcode() <= 11 && !instr.should_set_condition();
+			const bool shift_by_register = !instr.immediate_is_value() && instr.is_shift_reg();
+			return !psr_transfer && !shift_by_register && instr.destination_reg() != 15;
+		}
+		case InstructionType::SDT: {
+			const arm::SDTInstruction instr(opcode);
+			const bool shift_by_register = !instr.immediate_is_offset() && (instr.offset() & 0x10u);
+			return !shift_by_register && !(instr.load_from_memory() && instr.target_reg() == 15);
+		}
+		case InstructionType::HDT: {
+			const arm::HDTInstruction instr(opcode);
+			if(instr.opcode() == 0 || (instr.load_from_memory() && instr.target_reg() == 15)) {
+				return false;
+			}
+			return !(instr.base_reg() == 15 && (instr.writeback() || !instr.preindex()));
+		}
+		default: return false;
+	}
+}
+
+bool Translator::thumb_supported(uint16 opcode) const {
+	using disarmv4t::thumb::InstructionType;
+	switch(disarmv4t::thumb::decode(opcode)) {
+		case InstructionType::FMT1:
+		case InstructionType::FMT2:
+		case InstructionType::FMT3:
+		case InstructionType::FMT6:
+		case InstructionType::FMT7:
+		case InstructionType::FMT8:
+		case InstructionType::FMT9:
+		case InstructionType::FMT10:
+		case InstructionType::FMT11:
+		case InstructionType::FMT12:
+		case InstructionType::FMT13:
+		case InstructionType::FMT18: return true;
+		//  Shifts by register and MUL are left to the interpreter
+		case InstructionType::FMT4: {
+			const auto op = thumb::InstructionFormat4(opcode).opcode();
+			return op != 2 && op != 3 && op != 4 && op != 7 && op != 13;
+		}
+		case InstructionType::FMT5: {
+			const thumb::InstructionFormat5 instr(opcode);
+			return instr.opcode() == 1 || (instr.opcode() != 3 && instr.destination_reg() != 15);
+		}
+		case InstructionType::FMT16:
+			return thumb::InstructionFormat16(opcode).condition() <= InstructionCondition::LE;
+		case InstructionType::FMT19: return !thumb::InstructionFormat19(opcode).low();
+		default: return false;
+	}
+}
+
+bool Translator::arm_ends_block(uint32 opcode) {
+	return disarmv4t::arm::decode_fast(opcode) == disarmv4t::arm::InstructionType::BBL;
+}
+
+bool Translator::thumb_ends_block(uint16 opcode) {
+	using disarmv4t::thumb::InstructionType;
+	const auto type = disarmv4t::thumb::decode(opcode);
+	return type == InstructionType::FMT16 || type == InstructionType::FMT18;
+}
+
+/*
+ *  Registers used at least twice are cached, the most used ones first.
+ */
+void Translator::allocate_registers() {
+	std::array<unsigned, 15> order {};
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](unsigned a, unsigned b) { return m_uses[a] > m_uses[b]; });
+
+	size_t next = 0;
+	for(const auto reg : order) {
+		if(next == s_register_pool.size() || m_uses[reg] < 2) {
+			break;
+		}
+		m_host[reg] = s_register_pool[next++];
+	}
+}
+
+void Translator::emit_block() {
+	m_code = {};
+	m_stubs.clear();
+	m_written = 0;
+	m_epilogue = m_code.new_label();
+
+	emit_prologue();
+	for(m_index = 0; m_index < m_opcodes.size(); ++m_index) {
+		m_address = m_start + m_index * len();
+		m_stores = false;
+
+		if(m_index > 0) {
+			//  Leave once the next scheduler event is due
+			m_code.mov(rax, wait_cycles());
+			m_code.alu(Alu::Cmp, rax, Mem { rbx, m_budget_offset });
+			m_code.jcc(NC, exit_before());
+		}
+
+		if(m_thumb) {
+			thumb_instruction(static_cast<uint16>(m_opcodes[m_index]));
+		} else {
+			arm_instruction(m_opcodes[m_index]);
+		}
+
+		if(m_index + 1 == m_opcodes.size()) {
+			m_code.jmp(exit_after());
+		} else if(m_stores) {
+			//  Stores to I/O or to code leave the block after the instruction
+			m_code.cmp8(Mem { rbx, m_exit_offset }, Dynarec::Continue);
+			m_code.jcc(NZ, exit_after());
+		}
+	}
+
+	for(auto const& stub : m_stubs) {
+		m_code.bind(stub.label);
+		m_code.mov(guest(15), stub.pc);
+		m_code.mov(rax, stub.result);
+		m_code.jmp(m_epilogue);
+	}
+	emit_epilogue();
+}
+
+void Translator::emit_prologue() {
+	for(const auto reg : { rbx, rbp, r12, r13, r14, r15 }) {
+		m_code.push(reg);
+	}
+	//  Keep the stack 16-byte aligned for calls
+	m_code.sub_rsp(8);
+	m_code.mov64(rbx, rdi);
+	m_code.mov(r15, Mem { rbx, m_flags_offset });
+	for(unsigned reg = 0; reg < 15; ++reg) {
+		if(m_host[reg] != rsp) {
+			m_code.mov(m_host[reg], guest(reg));
+		}
+	}
+}
+
+void Translator::emit_epilogue() {
+	m_code.bind(m_epilogue);
+	for(unsigned reg = 0; reg < 15; ++reg) {
+		if(m_host[reg] != rsp && (m_written & (1u << reg))) {
+			m_code.mov(guest(reg), m_host[reg]);
+		}
+	}
+	m_code.mov(Mem { rbx, m_flags_offset }, r15);
+	m_code.add_rsp(8);
+	for(const auto reg : { r15, r14, r13, r12, rbp, rbx }) {
+		m_code.pop(reg);
+	}
+	m_code.ret();
+}
+
+Label Translator::exit_label(uint32 pc, uint32 result) {
+	for(auto const& stub : m_stubs) {
+		if(stub.pc == pc && stub.result == result) {
+			return stub.label;
+		}
+	}
+	m_stubs.push_back({ m_code.new_label(), pc, result });
+	return m_stubs.back().label;
+}
+
+void Translator::emit_exit(uint32 pc, uint32 result) {
+	m_code.jmp(exit_label(pc, result));
+}
+
+/*
+ *  Calls a runtime helper with the CPU as its first argument, the other
+ *  arguments must already be in rsi, rdx and rcx.
+ */
+void Translator::emit_call(void const* function, std::initializer_list<Reg> preserve) {
+	std::vector<Reg> saved(preserve);
+	for(unsigned reg = 0; reg < 15; ++reg) {
+		if(is_caller_saved(m_host[reg])) {
+			saved.push_back(m_host[reg]);
+		}
+	}
+
+	for(const auto reg : saved) {
+		m_code.push(reg);
+	}
+	const bool pad = saved.size() % 2 != 0;
+	if(pad) {
+		m_code.sub_rsp(8);
+	}
+	m_code.mov64(rdi, rbx);
+	m_code.mov64(rax, reinterpret_cast<uint64>(function));
+	m_code.call(rax);
+	if(pad) {
+		m_code.add_rsp(8);
+	}
+	for(auto it = saved.rbegin(); it != saved.rend(); ++it) {
+		m_code.pop(*it);
+	}
+}
+
+Reg Translator::read(unsigned reg, Reg scratch) {
+	if(reg == 15) {
+		m_code.mov(scratch, pc());
+		return scratch;
+	}
+	++m_uses[reg];
+	if(m_host[reg] != rsp) {
+		return m_host[reg];
+	}
+	m_code.mov(scratch, guest(reg));
+	return scratch;
+}
+
+void Translator::load(Reg dst, unsigned reg) {
+	m_code.mov(dst, read(reg, dst));
+}
+
+void Translator::write(unsigned reg, Reg src) {
+	++m_uses[reg];
+	m_written |= 1u << reg;
+	if(m_host[reg] != rsp) {
+		m_code.mov(m_host[reg], src);
+	} else {
+		m_code.mov(guest(reg), src);
+	}
+}
+
+void Translator::write(unsigned reg, uint32 value) {
+	++m_uses[reg];
+	m_written |= 1u << reg;
+	if(m_host[reg] != rsp) {
+		m_code.mov(m_host[reg], value);
+	} else {
+		m_code.mov(guest(reg), value);
+	}
+}
+
+void Translator::add_waits(unsigned waits) {
+	if(waits != 0) {
+		m_code.alu(Alu::Add, wait_cycles(), waits);
+	}
+}
+
+/*
+ *  Adds the non-sequential waits of a data access, which depend on the
+ *  address at runtime.
+ */
+void Translator::add_data_waits(Reg address, unsigned width_log2) {
+	m_code.mov(rcx, address);
+	m_code.shift(Shift::Shr, rcx, 24);
+	m_code.movzx8(rcx, Mem { rbx, m_data_waits_offset + 256 * static_cast<int32>(width_log2), rcx });
+	m_code.alu(Alu::Add, wait_cycles(), rcx);
+}
+
+/*
+ *  Jumps to the given label unless the condition holds. sahf loads N, Z and C
+ *  of the flags image into SF, ZF and CF, and adding 0x7f to V sets OF.
+ */
+void Translator::skip_unless(InstructionCondition cond, Label skip) {
+	if(cond == InstructionCondition::AL || cond == InstructionCondition::Reserved) {
+		return;
+	}
+
+	m_code.mov(rax, r15);
+	m_code.add8(rax, 0x7f);
+	m_code.sahf();
+	switch(cond) {
+		case InstructionCondition::EQ: m_code.jcc(NZ, skip); break;
+		case InstructionCondition::NE: m_code.jcc(Z, skip); break;
+		case InstructionCondition::CS: m_code.jcc(NC, skip); break;
+		case InstructionCondition::CC: m_code.jcc(C, skip); break;
+		case InstructionCondition::MI: m_code.jcc(NS, skip); break;
+		case InstructionCondition::PL: m_code.jcc(S, skip); break;
+		case InstructionCondition::VS: m_code.jcc(NO, skip); break;
+		case InstructionCondition::VC: m_code.jcc(O, skip); break;
+		case InstructionCondition::HI:
+			m_code.jcc(NC, skip);
+			m_code.jcc(Z, skip);
+			break;
+		case InstructionCondition::LS: {
+			const auto pass = m_code.new_label();
+			m_code.jcc(NC, pass);
+			m_code.jcc(NZ, skip);
+			m_code.bind(pass);
+			break;
+		}
+		case InstructionCondition::GE: m_code.jcc(L, skip); break;
+		case InstructionCondition::LT: m_code.jcc(GE, skip); break;
+		case InstructionCondition::GT: m_code.jcc(LE, skip); break;
+		case InstructionCondition::LE: m_code.jcc(G, skip); break;
+		default: break;
+	}
+}
+
+/*
+ *  Captures NZCV from the host flags of the last ALU instruction. The ARM
+ *  carry of a subtraction is the inverse of the x86 borrow.
+ */
+void Translator::save_nzcv(bool subtract) {
+	if(subtract) {
+		m_code.cmc();
+	}
+	m_code.lahf();
+	m_code.setcc(O, rax);
+	m_code.movzx16(r15, rax);
+}
+
+/*
+ *  Sets N and Z from the given result, C as requested, and leaves V alone.
+ */
+void Translator::save_nz(Reg result, Carry carry) {
+	m_code.test(result, result);
+	m_code.lahf();
+	m_code.alu(Alu::And, rax, 0xc000u);
+
+	uint32 keep = 0xffu;
+	switch(carry) {
+		case Carry::Unchanged: keep = 0x1ffu; break;
+		case Carry::Clear: break;
+		case Carry::Set: m_code.alu(Alu::Or, rax, 0x100u); break;
+		case Carry::Runtime:
+			m_code.movzx8(rdi, rdi);
+			m_code.shift(Shift::Shl, rdi, 8);
+			m_code.alu(Alu::Or, rax, rdi);
+			break;
+	}
+	m_code.alu(Alu::And, r15, keep);
+	m_code.alu(Alu::Or, r15, rax);
+}
+
+/*
+ *  Shifts the value like the barrel shifter of the interpreter. With
+ *  save_carry, the shifter carry out is saved to dil if the shift produces one.
+ */
+Translator::Carry Translator::shift_by_immediate(Reg value, ShiftType type, unsigned amount, bool save_carry) {
+	switch(type) {
+		case ShiftType::LogicalLeft:
+			if(amount == 0) {
+				return Carry::Unchanged;
+			}
+			m_code.shift(Shift::Shl, value, amount);
+			break;
+		case ShiftType::LogicalRight:
+			//  LSR #0 encodes LSR #32
+			if(amount == 0) {
+				m_code.bt(value, 31);
+				m_code.mov(value, 0u);
+			} else {
+				m_code.shift(Shift::Shr, value, amount);
+			}
+			break;
+		case ShiftType::ArithmeticRight:
+			//  ASR #0 encodes ASR #32
+			if(amount == 0) {
+				m_code.shift(Shift::Sar, value, 31);
+				m_code.bt(value, 0);
+			} else {
+				m_code.shift(Shift::Sar, value, amount);
+			}
+			break;
+		case ShiftType::RotateRight:
+			//  ROR #0 encodes RRX
+			if(amount == 0) {
+				m_code.bt(r15, 8);
+				m_code.shift(Shift::Rcr, value, 1);
+			} else {
+				m_code.shift(Shift::Ror, value, amount);
+			}
+			break;
+	}
+
+	if(!save_carry) {
+		return Carry::Unchanged;
+	}
+	m_code.setcc(C, rdi);
+	return Carry::Runtime;
+}
+
+/*
+ *  Loads from the address in esi into eax, with the same alignment, rotation
+ *  and sign extension as the interpreter. Preserves esi and edi.
+ */
+void Translator::emit_load(Access access) {
+	const auto done = m_code.new_label();
+	const auto slow = m_code.new_label();
+	const bool halfword = access == Access::Load16 || access == Access::LoadS16;
+	const uint32 align = access == Access::Load32 ? ~3u : (halfword ? ~1u : ~0u);
+
+	if(!m_regions.empty()) {
+		//  Misaligned signed halfword loads read a sign-extended byte
+		if(access == Access::LoadS16) {
+			m_code.test(rsi, 1u);
+			m_code.jcc(NZ, slow);
+		}
+		m_code.mov(rax, rsi);
+		m_code.shift(Shift::Shr, rax, 24);
+		for(auto const& region : m_regions) {
+			const auto next = m_code.new_label();
+			m_code.alu(Alu::Cmp, rax, region.index);
+			m_code.jcc(NZ, next);
+			m_code.mov(rcx, rsi);
+			m_code.alu(Alu::And, rcx, region.mapping->mask & align);
+			m_code.mov64(rax, reinterpret_cast<uint64>(region.mapping->base));
+
+			const Mem host { rax, 0, rcx };
+			switch(access) {
+				case Access::Load32:
+				case Access::Load16:
+					if(access == Access::Load32) {
+						m_code.mov(rax, host);
+					} else {
+						m_code.movzx16(rax, host);
+					}
+					//  Misaligned loads are rotated by the misaligned bytes
+					m_code.mov(rcx, rsi);
+					m_code.alu(Alu::And, rcx, ~align);
+					m_code.shift(Shift::Shl, rcx, 3);
+					m_code.shift(Shift::Ror, rax);
+					break;
+				case Access::LoadS16: m_code.movsx16(rax, host); break;
+				case Access::Load8: m_code.movzx8(rax, host); break;
+				case Access::LoadS8: m_code.movsx8(rax, host); break;
+				default: break;
+			}
+			m_code.jmp(done);
+			m_code.bind(next);
+		}
+	}
+
+	m_code.bind(slow);
+	m_code.mov(rdx, m_index == 0 ? 1u : 0u);
+	emit_call(Dynarec::slow_path(access), { rsi, rdi });
+	if(m_index > 0) {
+		m_code.cmp8(Mem { rbx, m_exit_offset }, Dynarec::Continue);
+		m_code.jcc(NZ, exit_before());
+	}
+	m_code.bind(done);
+}
+
+/*
+ *  Stores edx to the address in esi. Preserves esi and edi.
+ */
+void Translator::emit_store(Access access) {
+	const auto done = m_code.new_label();
+	const auto slow = m_code.new_label();
+	const uint32 size = access == Access::Store32 ? 4 : (access == Access::Store16 ? 2 : 1);
+	const uint32 align = ~(size - 1);
+	m_stores = true;
+
+	if(!m_regions.empty()) {
+		m_code.mov(rax, rsi);
+		m_code.shift(Shift::Shr, rax, 24);
+		for(auto const& region : m_regions) {
+			const auto next = m_code.new_label();
+			m_code.alu(Alu::Cmp, rax, region.index);
+			m_code.jcc(NZ, next);
+			if(m_lockstep) {
+				emit_call(reinterpret_cast<void const*>(&Dynarec::journal_store), { rsi, rdi, rdx });
+			}
+			m_code.mov(rcx, rsi);
+			m_code.alu(Alu::And, rcx, region.mapping->mask & align);
+			m_code.mov64(rax, reinterpret_cast<uint64>(region.mapping->base));
+
+			const Mem host { rax, 0, rcx };
+			switch(access) {
+				case Access::Store32: m_code.mov(host, rdx); break;
+				case Access::Store16: m_code.mov16(host, rdx); break;
+				default: m_code.mov8(host, rdx); break;
+			}
+
+			//  Writes to chunks that code was compiled or cached from
+			m_code.shift(Shift::Shr, rcx, CodeTracker::chunk_bits);
+			m_code.mov64(rax, reinterpret_cast<uint64>(region.code_bitmap));
+			m_code.bt64(Mem { rax }, rcx);
+			m_code.jcc(NC, done);
+			m_code.mov(rdx, size);
+			emit_call(reinterpret_cast<void const*>(&Dynarec::code_written), { rsi, rdi });
+			m_code.jmp(done);
+			m_code.bind(next);
+		}
+	}
+
+	m_code.bind(slow);
+	m_code.mov(rcx, m_index == 0 ? 1u : 0u);
+	emit_call(Dynarec::slow_path(access), { rsi, rdi });
+	if(m_index > 0) {
+		m_code.cmp8(Mem { rbx, m_exit_offset }, Dynarec::ExitBefore);
+		m_code.jcc(Z, exit_before());
+	}
+	m_code.bind(done);
+}
+
+/*  ==============================================
+ *                      ARM
+ *  ==============================================
+ */
+void Translator::arm_instruction(uint32 opcode) {
+	using disarmv4t::arm::InstructionType;
+	const auto cond = arm::Instruction(opcode).condition();
+	const bool conditional = cond != InstructionCondition::AL && cond != InstructionCondition::Reserved;
+	const auto skip = m_code.new_label();
+	skip_unless(cond, skip);
+
+	switch(disarmv4t::arm::decode_fast(opcode)) {
+		case InstructionType::BBL: arm_branch(opcode); break;
+		case InstructionType::ALU: arm_data_processing(opcode); break;
+		case InstructionType::SDT: arm_single_transfer(opcode); break;
+		case InstructionType::HDT: arm_halfword_transfer(opcode); break;
+		default: break;
+	}
+
+	if(conditional) {
+		//  Unevaluated instructions take one S-cycle
+		const auto next = m_code.new_label();
+		m_code.jmp(next);
+		m_code.bind(skip);
+		add_waits(bus().waits32(pc(), AccessType::Seq));
+		m_code.bind(next);
+	} else {
+		m_code.bind(skip);
+	}
+}
+
+void Translator::arm_branch(uint32 opcode) {
+	const arm::BInstruction instr(opcode);
+	const uint32 target = pc() + instr.offset();
+	if(instr.is_link()) {
+		write(14, pc() - 4);
+	}
+	add_waits(bus().waits32(pc(), AccessType::Seq) + bus().waits32(target, AccessType::NonSeq) +
+	          bus().waits32(target + 4, AccessType::Seq));
+	emit_exit(target + 8, (m_index + 1) | Dynarec::exit_taken);
+}
+
+/*
+ *  Operand 2 is evaluated into ecx and operand 1 into edx.
+ */
+void Translator::arm_data_processing(uint32 opcode) {
+	const arm::DataProcessInstruction instr(opcode);
+	const unsigned op = instr.opcode();
+	const bool S = instr.should_set_condition();
+	//  AND, EOR, TST, TEQ, ORR, MOV, BIC and MVN set C from the shifter
+	const bool logical = op <= 1 || (op >= 8 && op <= 9) || op >= 12;
+	const bool writes = op < 8 || op > 11;
+
+	auto carry = Carry::Unchanged;
+	if(instr.immediate_is_value()) {
+		const unsigned amount = instr.rotate() * 2;
+		const uint32 value = Bits::rotr32(instr.immediate(), amount);
+		m_code.mov(rcx, value);
+		if(logical && S && amount != 0) {
+			carry = (value & 0x80000000u) ? Carry::Set : Carry::Clear;
+		}
+	} else {
+		load(rcx, instr.operand2_reg());
+		carry = shift_by_immediate(rcx, instr.shift_type(), instr.shift_amount_or_reg(), logical && S);
+	}
+
+	if(op != 13 && op != 15) {
+		load(rdx, instr.operand1_reg());
+	}
+
+	auto result = rdx;
+	switch(op) {
+		case 0:
+		case 8: m_code.alu(Alu::And, rdx, rcx); break;
+		case 1:
+		case 9: m_code.alu(Alu::Xor, rdx, rcx); break;
+		case 2:
+		case 10: m_code.alu(Alu::Sub, rdx, rcx); break;
+		case 3:
+			m_code.alu(Alu::Sub, rcx, rdx);
+			result = rcx;
+			break;
+		case 4:
+		case 11: m_code.alu(Alu::Add, rdx, rcx); break;
+		case 5:
+			m_code.bt(r15, 8);
+			m_code.alu(Alu::Adc, rdx, rcx);
+			break;
+		case 6:
+			m_code.bt(r15, 8);
+			m_code.cmc();
+			m_code.alu(Alu::Sbb, rdx, rcx);
+			break;
+		case 7:
+			m_code.bt(r15, 8);
+			m_code.cmc();
+			m_code.alu(Alu::Sbb, rcx, rdx);
+			result = rcx;
+			break;
+		case 12: m_code.alu(Alu::Or, rdx, rcx); break;
+		case 13: result = rcx; break;
+		case 14:
+			m_code.not_(rcx);
+			m_code.alu(Alu::And, rdx, rcx);
+			break;
+		case 15:
+			m_code.not_(rcx);
+			result = rcx;
+			break;
+		default: break;
+	}
+
+	if(S) {
+		if(logical) {
+			save_nz(result, carry);
+		} else {
+			save_nzcv(op == 2 || op == 3 || op == 6 || op == 7 || op == 10);
+		}
+	}
+	if(writes) {
+		write(instr.destination_reg(), result);
+	}
+	add_waits(bus().waits32(pc(), AccessType::Seq));
+}
+
+/*
+ *  The address is calculated into esi and the written back base into edi.
+ */
+void Translator::arm_single_transfer(uint32 opcode) {
+	const arm::SDTInstruction instr(opcode);
+	const unsigned rn = instr.base_reg();
+	const unsigned rd = instr.target_reg();
+	const bool byte = instr.quantity_in_bytes();
+	const bool writeback = (instr.writeback() || !instr.preindex()) && rn != 15;
+
+	load(rsi, rn);
+	m_code.mov(rdi, rsi);
+	const auto offset_op = instr.add_offset_to_base() ? Alu::Add : Alu::Sub;
+	if(instr.immediate_is_offset()) {
+		if(instr.offset() != 0) {
+			m_code.alu(offset_op, rdi, static_cast<uint32>(instr.offset()));
+		}
+	} else {
+		const arm::DataProcessInstruction shift(instr.offset());
+		load(rcx, shift.operand2_reg());
+		shift_by_immediate(rcx, shift.shift_type(), shift.shift_amount_or_reg(), false);
+		m_code.alu(offset_op, rdi, rcx);
+	}
+	if(instr.preindex()) {
+		m_code.mov(rsi, rdi);
+	}
+
+	if(instr.load_from_memory()) {
+		emit_load(byte ? Access::Load8 : Access::Load32);
+		if(writeback) {
+			write(rn, rdi);
+		}
+		write(rd, rax);
+		add_waits(1 + bus().waits32(pc() + 12, AccessType::Seq));
+		add_data_waits(rdi, byte ? 0 : 2);
+	} else {
+		if(rd == 15) {
+			m_code.mov(rdx, pc() + 4);
+		} else {
+			load(rdx, rd);
+		}
+		emit_store(byte ? Access::Store8 : Access::Store32);
+		if(writeback) {
+			write(rn, rdi);
+		}
+		//  Word stores take the halfword waits, like the interpreter
+		add_waits(bus().waits32(pc() + 12, AccessType::NonSeq));
+		add_data_waits(rdi, byte ? 0 : 1);
+	}
+}
+
+void Translator::arm_halfword_transfer(uint32 opcode) {
+	const arm::HDTInstruction instr(opcode);
+	const unsigned rn = instr.base_reg();
+	const unsigned rd = instr.target_reg();
+	const unsigned width_log2 = instr.opcode() == 2 ? 0 : 1;
+	const bool writeback = instr.writeback() || !instr.preindex();
+
+	load(rsi, rn);
+	m_code.mov(rdi, rsi);
+	const auto offset_op = instr.add_offset_to_base() ? Alu::Add : Alu::Sub;
+	if(instr.is_offset_immediate()) {
+		if(instr.immediate() != 0) {
+			m_code.alu(offset_op, rdi, static_cast<uint32>(instr.immediate()));
+		}
+	} else {
+		m_code.alu(offset_op, rdi, read(instr.offset_reg_or_immediate_low(), rcx));
+	}
+	if(instr.preindex()) {
+		m_code.mov(rsi, rdi);
+	}
+
+	if(instr.load_from_memory()) {
+		static constexpr std::array<Access, 4> loads { Access::Load16, Access::Load16, Access::LoadS8,
+			                                           Access::LoadS16 };
+		emit_load(loads[instr.opcode()]);
+		if(writeback) {
+			write(rn, rdi);
+		}
+		write(rd, rax);
+		add_waits(1 + bus().waits32(pc() + 12, AccessType::Seq));
+		add_data_waits(rdi, width_log2);
+	} else {
+		load(rdx, rd);
+		emit_store(instr.opcode() == 2 ? Access::Store8 : Access::Store16);
+		if(writeback) {
+			write(rn, rdi);
+		}
+		add_waits(bus().waits32(pc() + 12, AccessType::NonSeq));
+		add_data_waits(rdi, width_log2);
+	}
+}
+
+/*  ==============================================
+ *                      THUMB
+ *  ==============================================
+ */
+void Translator::thumb_instruction(uint16 opcode) {
+	using disarmv4t::thumb::InstructionType;
+	switch(disarmv4t::thumb::decode(opcode)) {
+		case InstructionType::FMT1: {
+			const thumb::InstructionFormat1 instr(opcode);
+			load(rdx, instr.source_reg());
+			const auto carry =
+			        shift_by_immediate(rdx, static_cast<ShiftType>(instr.opcode()), instr.immediate(), true);
+			save_nz(rdx, carry);
+			write(instr.destination_reg(), rdx);
+			add_waits(bus().waits16(pc(), AccessType::Seq));
+			break;
+		}
+		case InstructionType::FMT2: {
+			const thumb::InstructionFormat2 instr(opcode);
+			load(rdx, instr.source_reg());
+			if(instr.immediate_is_value()) {
+				m_code.mov(rcx, static_cast<uint32>(instr.immediate()));
+			} else {
+				load(rcx, instr.immediate());
+			}
+			m_code.alu(instr.subtract() ? Alu::Sub : Alu::Add, rdx, rcx);
+			save_nzcv(instr.subtract());
+			write(instr.destination_reg(), rdx);
+			add_waits(bus().waits16(pc(), AccessType::Seq));
+			break;
+		}
+		case InstructionType::FMT3: {
+			const thumb::InstructionFormat3 instr(opcode);
+			const unsigned rd = instr.target_reg();
+			const uint32 immediate = instr.immediate();
+			if(instr.opcode() == 0) {
+				m_code.mov(rdx, immediate);
+				save_nz(rdx, Carry::Unchanged);
+				write(rd, rdx);
+			} else {
+				load(rdx, rd);
+				const bool add = instr.opcode() == 2;
+				m_code.alu(add ? Alu::Add : Alu::Sub, rdx, immediate);
+				save_nzcv(!add);
+				if(instr.opcode() != 1) {
+					write(rd, rdx);
+				}
+			}
+			add_waits(bus().waits16(pc(), AccessType::Seq));
+			break;
+		}
+		case InstructionType::FMT4: thumb_alu(opcode); break;
+		case InstructionType::FMT5: thumb_hi_register(opcode); break;
+		case InstructionType::FMT6: {
+			const thumb::InstructionFormat6 instr(opcode);
+			const uint32 address = (pc() & ~3u) + (static_cast<uint32>(instr.immediate()) << 2u);
+			m_code.mov(rsi, address);
+			emit_load(Access::Load32);
+			write(instr.destination_reg(), rax);
+			add_waits(1 + bus().waits16(pc(), AccessType::Seq) + bus().waits32(address, AccessType::NonSeq));
+			break;
+		}
+		case InstructionType::FMT7:
+		case InstructionType::FMT8: thumb_register_offset(opcode); break;
+		case InstructionType::FMT9:
+		case InstructionType::FMT10:
+		case InstructionType::FMT11: thumb_immediate_offset(opcode); break;
+		case InstructionType::FMT12: {
+			const thumb::InstructionFormat12 instr(opcode);
+			const uint32 offset = static_cast<uint32>(instr.immediate()) << 2u;
+			if(instr.source_is_sp()) {
+				load(rdx, 13);
+				m_code.alu(Alu::Add, rdx, offset);
+				write(instr.destination_reg(), rdx);
+			} else {
+				write(instr.destination_reg(), (pc() & ~2u) + offset);
+			}
+			add_waits(bus().waits16(pc(), AccessType::Seq));
+			break;
+		}
+		case InstructionType::FMT13: {
+			const thumb::InstructionFormat13 instr(opcode);
+			load(rdx, 13);
+			m_code.alu(instr.offset_is_negative() ? Alu::Sub : Alu::Add, rdx,
+			           static_cast<uint32>(instr.offset()) << 2u);
+			write(13, rdx);
+			add_waits(bus().waits16(pc(), AccessType::Seq));
+			break;
+		}
+		case InstructionType::FMT16: {
+			const thumb::InstructionFormat16 instr(opcode);
+			const auto offset = Bits::sign_extend<9>(static_cast<uint16>(instr.offset()) << 1u);
+			thumb_branch(pc() + offset, instr.condition());
+			break;
+		}
+		case InstructionType::FMT18: {
+			const thumb::InstructionFormat18 instr(opcode);
+			thumb_branch(pc() + Bits::sign_extend<12>(instr.offset() << 1u), InstructionCondition::AL);
+			break;
+		}
+		case InstructionType::FMT19: {
+			const thumb::InstructionFormat19 instr(opcode);
+			write(14, pc() + Bits::sign_extend<23>(static_cast<uint32>(instr.offset()) << 12u));
+			add_waits(bus().waits16(pc(), AccessType::Seq));
+			break;
+		}
+		default: break;
+	}
+}
+
+/*
+ *  Format 4, the destination is loaded into edx and the source into ecx.
+ */
+void Translator::thumb_alu(uint16 opcode) {
+	const thumb::InstructionFormat4 instr(opcode);
+	const unsigned op = instr.opcode();
+	const unsigned rd = instr.target_reg();
+
+	add_waits(bus().waits16(pc() + 4, AccessType::Seq));
+	if(op != 9 && op != 15) {
+		load(rdx, rd);
+	}
+	load(rcx, instr.source_reg());
+
+	switch(op) {
+		case 0:
+		case 8: m_code.alu(Alu::And, rdx, rcx); break;
+		case 1: m_code.alu(Alu::Xor, rdx, rcx); break;
+		case 5:
+			m_code.bt(r15, 8);
+			m_code.alu(Alu::Adc, rdx, rcx);
+			break;
+		case 6:
+			m_code.bt(r15, 8);
+			m_code.cmc();
+			m_code.alu(Alu::Sbb, rdx, rcx);
+			break;
+		case 9:
+			m_code.mov(rdx, 0u);
+			m_code.alu(Alu::Sub, rdx, rcx);
+			break;
+		case 10: m_code.alu(Alu::Sub, rdx, rcx); break;
+		case 11: m_code.alu(Alu::Add, rdx, rcx); break;
+		case 12: m_code.alu(Alu::Or, rdx, rcx); break;
+		case 14:
+			m_code.not_(rcx);
+			m_code.alu(Alu::And, rdx, rcx);
+			break;
+		case 15:
+			m_code.mov(rdx, rcx);
+			m_code.not_(rdx);
+			break;
+		default: break;
+	}
+
+	switch(op) {
+		case 5:
+		case 11: save_nzcv(false); break;
+		case 6:
+		case 9:
+		case 10: save_nzcv(true); break;
+		default: save_nz(rdx, Carry::Unchanged); break;
+	}
+	//  TST, CMP and CMN only set the flags
+	if(op != 8 && op != 10 && op != 11) {
+		write(rd, rdx);
+	}
+}
+
+void Translator::thumb_hi_register(uint16 opcode) {
+	const thumb::InstructionFormat5 instr(opcode);
+	const unsigned rd = instr.destination_reg();
+	const unsigned rs = instr.source_reg();
+
+	switch(instr.opcode()) {
+		case 0:
+			load(rdx, rd);
+			m_code.alu(Alu::Add, rdx, read(rs, rcx));
+			write(rd, rdx);
+			break;
+		case 1:
+			load(rdx, rd);
+			m_code.alu(Alu::Sub, rdx, read(rs, rcx));
+			save_nzcv(true);
+			break;
+		default:
+			load(rdx, rs);
+			write(rd, rdx);
+			break;
+	}
+	add_waits(bus().waits16(pc(), AccessType::Seq));
+}
+
+/*
+ *  Formats 7 and 8, the address is calculated into esi.
+ */
+void Translator::thumb_register_offset(uint16 opcode) {
+	const unsigned rd = opcode & 7u;
+	load(rsi, (opcode >> 3u) & 7u);
+	m_code.alu(Alu::Add, rsi, read((opcode >> 6u) & 7u, rcx));
+
+	auto do_load = [&](Access access, unsigned width_log2) {
+		emit_load(access);
+		write(rd, rax);
+		add_waits(1 + bus().waits16(pc(), AccessType::Seq));
+		add_data_waits(rsi, width_log2);
+	};
+	auto do_store = [&](Access access, unsigned width_log2) {
+		load(rdx, rd);
+		emit_store(access);
+		add_waits(bus().waits16(pc(), AccessType::NonSeq));
+		add_data_waits(rsi, width_log2);
+	};
+
+	if(disarmv4t::thumb::decode(opcode) == disarmv4t::thumb::InstructionType::FMT7) {
+		const thumb::InstructionFormat7 instr(opcode);
+		const bool byte = instr.quantity_in_bytes();
+		if(instr.load_from_memory()) {
+			do_load(byte ? Access::Load8 : Access::Load32, byte ? 0 : 2);
+		} else {
+			do_store(byte ? Access::Store8 : Access::Store32, byte ? 0 : 2);
+		}
+		return;
+	}
+
+	switch(thumb::InstructionFormat8(opcode).opcode()) {
+		case 0: do_store(Access::Store16, 1); break;
+		case 1: do_load(Access::LoadS8, 0); break;
+		case 2: do_load(Access::Load16, 1); break;
+		default: do_load(Access::LoadS16, 1); break;
+	}
+}
+
+/*
+ *  Formats 9, 10 and 11, the address is calculated into esi.
+ */
+void Translator::thumb_immediate_offset(uint16 opcode) {
+	using disarmv4t::thumb::InstructionType;
+	const auto type = disarmv4t::thumb::decode(opcode);
+	const bool load_from_memory = opcode & (1u << 11u);
+
+	unsigned rd;
+	uint32 offset;
+	Access access;
+	unsigned width_log2;
+	if(type == InstructionType::FMT9) {
+		const thumb::InstructionFormat9 instr(opcode);
+		const bool byte = instr.quantity_in_bytes();
+		rd = instr.target_reg();
+		load(rsi, instr.base_reg());
+		offset = byte ? instr.offset() : static_cast<uint32>(instr.offset()) << 2u;
+		access = byte ? (load_from_memory ? Access::Load8 : Access::Store8)
+		              : (load_from_memory ? Access::Load32 : Access::Store32);
+		width_log2 = byte ? 0 : 2;
+	} else if(type == InstructionType::FMT10) {
+		const thumb::InstructionFormat10 instr(opcode);
+		rd = instr.target_reg();
+		load(rsi, instr.base_reg());
+		offset = static_cast<uint32>(instr.offset()) << 1u;
+		access = load_from_memory ? Access::Load16 : Access::Store16;
+		width_log2 = 1;
+	} else {
+		const thumb::InstructionFormat11 instr(opcode);
+		rd = instr.destination_reg();
+		load(rsi, 13);
+		offset = static_cast<uint32>(instr.immediate()) << 2u;
+		access = load_from_memory ? Access::Load32 : Access::Store32;
+		width_log2 = 2;
+	}
+	if(offset != 0) {
+		m_code.alu(Alu::Add, rsi, offset);
+	}
+
+	if(load_from_memory) {
+		emit_load(access);
+		write(rd, rax);
+		add_waits(1 + bus().waits16(pc(), AccessType::Seq));
+	} else {
+		load(rdx, rd);
+		emit_store(access);
+		add_waits(bus().waits16(pc(), AccessType::NonSeq));
+	}
+	add_data_waits(rsi, width_log2);
+}
+
+void Translator::thumb_branch(uint32 target, InstructionCondition cond) {
+	const auto skip = m_code.new_label();
+	skip_unless(cond, skip);
+	add_waits(bus().waits16(pc(), AccessType::Seq) + bus().waits16(target, AccessType::NonSeq) +
+	          bus().waits16(target + 2, AccessType::Seq));
+	emit_exit((target + 4) & ~1u, (m_index + 1) | Dynarec::exit_taken);
+
+	if(cond != InstructionCondition::AL) {
+		m_code.bind(skip);
+		add_waits(bus().waits16(pc(), AccessType::Seq));
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <array>
+#include <disarmv4t/arm.hpp>
+#include <disarmv4t/thumb.hpp>
+#include <vector>
+#include "CPU/Dynarec/Dynarec.hpp"
+#include "CPU/Dynarec/X64Emitter.hpp"
+#include "Emulator/Module.hpp"
+#include "Emulator/StdTypes.hpp"
+
+struct HostMapping;
+
+/*
+ *  Translates one block of guest code into a host function taking the
+ *  ARM7TDMI in rdi, see Dynarec::BlockFunction.
+ *
+ *  Within the block, the most used guest registers live in host registers,
+ *  and NZCV live in r15d in the layout of Dynarec::m_flags. Both are written
+ *  back on every exit. rbx holds the CPU, and rax, rcx, rdx, rsi and rdi are
+ *  scratch registers. r15 of the guest is a constant, as the block knows the
+ *  address of every instruction.
+ *
+ *  Loads and stores to IWRAM and EWRAM access the host memory directly, and
+ *  stores check the code bitmap of the region's CodeTracker. Everything else
+ *  calls into the bus through the Dynarec's runtime helpers.
+ */
+class Translator : Module {
+	using Access = Dynarec::Access;
+
+	enum class Carry {
+		Unchanged,
+		Clear,
+		Set,
+		//  The shifter carry was saved in dil
+		Runtime,
+	};
+
+	//  Host memory of a bus region that loads and stores access inline
+	struct InlineRegion {
+		uint32 index;
+		HostMapping const* mapping;
+		uint64 const* code_bitmap;
+	};
+
+	struct ExitStub {
+		x64::Label label;
+		uint32 pc;
+		uint32 result;
+	};
+
+	Dynarec& m_dynarec;
+	const uint32 m_start;
+	const bool m_thumb;
+	const bool m_lockstep;
+	std::vector<uint32> m_opcodes;
+	std::vector<InlineRegion> m_regions;
+
+	x64::Emitter m_code;
+	std::vector<ExitStub> m_stubs;
+	x64::Label m_epilogue { 0 };
+
+	//  Host register caching each guest register, rsp if it is not cached
+	std::array<x64::Reg, 16> m_host {};
+	std::array<unsigned, 16> m_uses {};
+	uint16 m_written { 0 };
+
+	//  The instruction being translated
+	unsigned m_index { 0 };
+	uint32 m_address { 0 };
+	bool m_stores { false };
+
+	//  Offsets of the state accessed by the generated code from the ARM7TDMI
+	int32 m_registers_offset { 0 };
+	int32 m_wait_cycles_offset { 0 };
+	int32 m_flags_offset { 0 };
+	int32 m_budget_offset { 0 };
+	int32 m_exit_offset { 0 };
+	int32 m_data_waits_offset { 0 };
+
+	unsigned len() const { return m_thumb ? 2 : 4; }
+	//  Value of r15 seen by the current instruction
+	uint32 pc() const { return m_address + 2 * len(); }
+
+	bool scan();
+	bool arm_supported(uint32 opcode) const;
+	bool thumb_supported(uint16 opcode) const;
+	static bool arm_ends_block(uint32 opcode);
+	static bool thumb_ends_block(uint16 opcode);
+	void allocate_registers();
+
+	void emit_block();
+	void emit_prologue();
+	void emit_epilogue();
+	x64::Label exit_label(uint32 pc, uint32 result);
+	x64::Label exit_after() { return exit_label(m_address + 3 * len(), m_index + 1); }
+	x64::Label exit_before() { return exit_label(m_address + 2 * len(), m_index); }
+	void emit_exit(uint32 pc, uint32 result);
+	void emit_call(void const* function, std::initializer_list<x64::Reg> preserve);
+
+	x64::Mem guest(unsigned reg) const { return { x64::rbx, m_registers_offset + 4 * static_cast<int32>(reg) }; }
+	x64::Mem wait_cycles() const { return { x64::rbx, m_wait_cycles_offset }; }
+	x64::Reg read(unsigned reg, x64::Reg scratch);
+	void load(x64::Reg dst, unsigned reg);
+	void write(unsigned reg, x64::Reg src);
+	void write(unsigned reg, uint32 value);
+
+	void add_waits(unsigned waits);
+	void add_data_waits(x64::Reg address, unsigned width_log2);
+	void skip_unless(disarmv4t::InstructionCondition, x64::Label skip);
+	void save_nzcv(bool subtract);
+	void save_nz(x64::Reg result, Carry carry);
+	Carry shift_by_immediate(x64::Reg value, disarmv4t::ShiftType, unsigned amount, bool save_carry);
+	void emit_load(Access access);
+	void emit_store(Access access);
+
+	void arm_instruction(uint32 opcode);
+	void arm_data_processing(uint32 opcode);
+	void arm_branch(uint32 opcode);
+	void arm_single_transfer(uint32 opcode);
+	void arm_halfword_transfer(uint32 opcode);
+
+	void thumb_instruction(uint16 opcode);
+	void thumb_alu(uint16 opcode);
+	void thumb_hi_register(uint16 opcode);
+	void thumb_register_offset(uint16 opcode);
+	void thumb_immediate_offset(uint16 opcode);
+	void thumb_branch(uint32 target, disarmv4t::InstructionCondition);
+public:
+	Translator(GaBber&, Dynarec&, uint32 address, bool thumb, bool lockstep);
+
+	/*
+	 *  Returns the machine code of the block, or nothing if not even its first
+	 *  instruction can be translated.
+	 */
+	std::vector<uint8> translate();
+};
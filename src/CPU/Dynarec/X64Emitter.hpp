@@ -0,0 +1,332 @@
+#pragma once
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <vector>
+#include "Emulator/StdTypes.hpp"
+
+namespace x64 {
+
+enum Reg : uint8 {
+	rax,
+	rcx,
+	rdx,
+	rbx,
+	rsp,
+	rbp,
+	rsi,
+	rdi,
+	r8,
+	r9,
+	r10,
+	r11,
+	r12,
+	r13,
+	r14,
+	r15
+};
+
+/*
+ *  Memory operand [base + index + disp], an index of rsp means no index.
+ */
+struct Mem {
+	Reg base;
+	int32 disp { 0 };
+	Reg index { rsp };
+};
+
+enum Condition : uint8 {
+	O = 0x0,
+	NO = 0x1,
+	C = 0x2,
+	NC = 0x3,
+	Z = 0x4,
+	NZ = 0x5,
+	BE = 0x6,
+	A = 0x7,
+	S = 0x8,
+	NS = 0x9,
+	P = 0xa,
+	NP = 0xb,
+	L = 0xc,
+	GE = 0xd,
+	LE = 0xe,
+	G = 0xf
+};
+
+//  The /digit of the group 1 ALU instructions
+enum class Alu : uint8 {
+	Add = 0,
+	Or = 1,
+	Adc = 2,
+	Sbb = 3,
+	And = 4,
+	Sub = 5,
+	Xor = 6,
+	Cmp = 7
+};
+
+//  The /digit of the group 2 shift instructions
+enum class Shift : uint8 {
+	Rol = 0,
+	Ror = 1,
+	Rcl = 2,
+	Rcr = 3,
+	Shl = 4,
+	Shr = 5,
+	Sar = 7
+};
+
+using Label = size_t;
+
+/*
+ *  Minimal x86-64 machine code emitter, covering only the instructions used
+ *  by the recompiler. Register operations are 32-bit unless their name says
+ *  otherwise. Jumps always use 32-bit displacements and are resolved when
+ *  the label they refer to is bound.
+ */
+class Emitter {
+	static constexpr size_t unbound = std::numeric_limits<size_t>::max();
+
+	struct Fixup {
+		size_t position;
+		Label label;
+	};
+
+	std::vector<uint8> m_code;
+	std::vector<size_t> m_labels;
+	std::vector<Fixup> m_fixups;
+
+	void emit(std::initializer_list<uint8> bytes) { m_code.insert(m_code.end(), bytes); }
+
+	template<typename T>
+	void emit_imm(T value) {
+		uint8 bytes[sizeof(T)];
+		std::memcpy(bytes, &value, sizeof(T));
+		m_code.insert(m_code.end(), bytes, bytes + sizeof(T));
+	}
+
+	static bool fits_int8(int32 value) { return value >= -128 && value <= 127; }
+
+	//  spl, bpl, sil and dil are only addressable with a REX prefix
+	static bool needs_rex_byte(unsigned reg) { return reg >= 4 && reg < 8; }
+
+	void rex(bool wide, unsigned reg, unsigned index, unsigned base, bool force = false) {
+		const uint8 prefix = 0x40 | (wide ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((index & 8) ? 0x02 : 0) |
+		                     ((base & 8) ? 0x01 : 0);
+		if(prefix != 0x40 || force) {
+			emit({ prefix });
+		}
+	}
+
+	void modrm_reg(unsigned reg, unsigned rm) { emit({ static_cast<uint8>(0xc0 | ((reg & 7) << 3) | (rm & 7)) }); }
+
+	void modrm_mem(unsigned reg, Mem m) {
+		const bool sib = m.index != rsp || (m.base & 7) == rsp;
+		//  rbp and r13 as the base always need a displacement
+		uint8 mod;
+		if(m.disp == 0 && (m.base & 7) != rbp) {
+			mod = 0x00;
+		} else if(fits_int8(m.disp)) {
+			mod = 0x40;
+		} else {
+			mod = 0x80;
+		}
+
+		emit({ static_cast<uint8>(mod | ((reg & 7) << 3) | (sib ? 4 : (m.base & 7))) });
+		if(sib) {
+			emit({ static_cast<uint8>(((m.index & 7) << 3) | (m.base & 7)) });
+		}
+		if(mod == 0x40) {
+			emit_imm<int8>(static_cast<int8>(m.disp));
+		} else if(mod == 0x80) {
+			emit_imm<int32>(m.disp);
+		}
+	}
+
+	void op_rr(std::initializer_list<uint8> opcode, unsigned reg, unsigned rm, bool wide = false,
+	           bool byte_reg = false) {
+		rex(wide, reg, 0, rm, byte_reg && needs_rex_byte(reg));
+		emit(opcode);
+		modrm_reg(reg, rm);
+	}
+
+	void op_rm(std::initializer_list<uint8> opcode, unsigned reg, Mem m, bool wide = false, bool byte_reg = false) {
+		rex(wide, reg, m.index, m.base, byte_reg && needs_rex_byte(reg));
+		emit(opcode);
+		modrm_mem(reg, m);
+	}
+
+	void fixup(Label label) {
+		m_fixups.push_back({ m_code.size(), label });
+		emit_imm<int32>(0);
+	}
+public:
+	std::vector<uint8> const& code() const { return m_code; }
+	size_t size() const { return m_code.size(); }
+
+	Label new_label() {
+		m_labels.push_back(unbound);
+		return m_labels.size() - 1;
+	}
+	void bind(Label label) { m_labels[label] = m_code.size(); }
+
+	/*
+	 *  Patches all jumps to their labels, returns false if a label was never
+	 *  bound.
+	 */
+	bool finish() {
+		for(auto const& fixup : m_fixups) {
+			const size_t target = m_labels[fixup.label];
+			if(target == unbound) {
+				return false;
+			}
+			const auto displacement = static_cast<int32>(target - (fixup.position + 4));
+			std::memcpy(m_code.data() + fixup.position, &displacement, 4);
+		}
+		m_fixups.clear();
+		return true;
+	}
+
+	void jmp(Label label) {
+		emit({ 0xe9 });
+		fixup(label);
+	}
+	void jcc(Condition cond, Label label) {
+		emit({ 0x0f, static_cast<uint8>(0x80 | cond) });
+		fixup(label);
+	}
+
+	void push(Reg reg) {
+		rex(false, 0, 0, reg);
+		emit({ static_cast<uint8>(0x50 | (reg & 7)) });
+	}
+	void pop(Reg reg) {
+		rex(false, 0, 0, reg);
+		emit({ static_cast<uint8>(0x58 | (reg & 7)) });
+	}
+	void ret() { emit({ 0xc3 }); }
+	void call(Reg reg) { op_rr({ 0xff }, 2, reg); }
+	void sub_rsp(int8 value) {
+		emit({ 0x48, 0x83, 0xec });
+		emit_imm(value);
+	}
+	void add_rsp(int8 value) {
+		emit({ 0x48, 0x83, 0xc4 });
+		emit_imm(value);
+	}
+
+	void mov(Reg dst, Reg src) {
+		if(dst != src) {
+			op_rr({ 0x89 }, src, dst);
+		}
+	}
+	void mov(Reg dst, uint32 value) {
+		rex(false, 0, 0, dst);
+		emit({ static_cast<uint8>(0xb8 | (dst & 7)) });
+		emit_imm(value);
+	}
+	void mov(Reg dst, Mem src) { op_rm({ 0x8b }, dst, src); }
+	void mov(Mem dst, Reg src) { op_rm({ 0x89 }, src, dst); }
+	void mov(Mem dst, uint32 value) {
+		op_rm({ 0xc7 }, 0, dst);
+		emit_imm(value);
+	}
+	void mov16(Mem dst, Reg src) {
+		emit({ 0x66 });
+		op_rm({ 0x89 }, src, dst);
+	}
+	void mov8(Mem dst, Reg src) { op_rm({ 0x88 }, src, dst, false, true); }
+	void mov8(Mem dst, uint8 value) {
+		op_rm({ 0xc6 }, 0, dst);
+		emit_imm(value);
+	}
+	void mov64(Reg dst, Reg src) { op_rr({ 0x89 }, src, dst, true); }
+	void mov64(Reg dst, uint64 value) {
+		rex(true, 0, 0, dst);
+		emit({ static_cast<uint8>(0xb8 | (dst & 7)) });
+		emit_imm(value);
+	}
+	void mov64(Reg dst, Mem src) { op_rm({ 0x8b }, dst, src, true); }
+
+	void movzx8(Reg dst, Mem src) { op_rm({ 0x0f, 0xb6 }, dst, src); }
+	void movzx16(Reg dst, Mem src) { op_rm({ 0x0f, 0xb7 }, dst, src); }
+	void movsx8(Reg dst, Mem src) { op_rm({ 0x0f, 0xbe }, dst, src); }
+	void movsx16(Reg dst, Mem src) { op_rm({ 0x0f, 0xbf }, dst, src); }
+	void movzx8(Reg dst, Reg src) {
+		rex(false, dst, 0, src, needs_rex_byte(src));
+		emit({ 0x0f, 0xb6 });
+		modrm_reg(dst, src);
+	}
+	void movzx16(Reg dst, Reg src) { op_rr({ 0x0f, 0xb7 }, dst, src); }
+
+	void alu(Alu op, Reg dst, Reg src) { op_rr({ static_cast<uint8>(0x01 | (static_cast<uint8>(op) << 3)) }, src, dst); }
+	void alu(Alu op, Reg dst, Mem src) { op_rm({ static_cast<uint8>(0x03 | (static_cast<uint8>(op) << 3)) }, dst, src); }
+	void alu(Alu op, Reg dst, uint32 value) {
+		const auto imm = static_cast<int32>(value);
+		if(fits_int8(imm)) {
+			op_rr({ 0x83 }, static_cast<uint8>(op), dst);
+			emit_imm<int8>(static_cast<int8>(imm));
+		} else {
+			op_rr({ 0x81 }, static_cast<uint8>(op), dst);
+			emit_imm(value);
+		}
+	}
+	void alu(Alu op, Mem dst, Reg src) { op_rm({ static_cast<uint8>(0x01 | (static_cast<uint8>(op) << 3)) }, src, dst); }
+	void alu(Alu op, Mem dst, uint32 value) {
+		const auto imm = static_cast<int32>(value);
+		if(fits_int8(imm)) {
+			op_rm({ 0x83 }, static_cast<uint8>(op), dst);
+			emit_imm<int8>(static_cast<int8>(imm));
+		} else {
+			op_rm({ 0x81 }, static_cast<uint8>(op), dst);
+			emit_imm(value);
+		}
+	}
+	void cmp8(Mem dst, uint8 value) {
+		op_rm({ 0x80 }, 7, dst);
+		emit_imm(value);
+	}
+	void test(Reg a, Reg b) { op_rr({ 0x85 }, b, a); }
+	void test(Reg reg, uint32 value) {
+		op_rr({ 0xf7 }, 0, reg);
+		emit_imm(value);
+	}
+	void not_(Reg reg) { op_rr({ 0xf7 }, 2, reg); }
+	void neg(Reg reg) { op_rr({ 0xf7 }, 3, reg); }
+
+	void shift(Shift op, Reg reg, uint8 count) {
+		if(count == 1) {
+			op_rr({ 0xd1 }, static_cast<uint8>(op), reg);
+		} else {
+			op_rr({ 0xc1 }, static_cast<uint8>(op), reg);
+			emit_imm(count);
+		}
+	}
+	//  Shift by cl
+	void shift(Shift op, Reg reg) { op_rr({ 0xd3 }, static_cast<uint8>(op), reg); }
+
+	void bt(Reg reg, uint8 bit) {
+		op_rr({ 0x0f, 0xba }, 4, reg);
+		emit_imm(bit);
+	}
+	//  Tests the bit at the given 64-bit register offset in the bit string at the memory operand
+	void bt64(Mem bits, Reg offset) { op_rm({ 0x0f, 0xa3 }, offset, bits, true); }
+
+	void setcc(Condition cond, Reg reg) {
+		rex(false, 0, 0, reg, needs_rex_byte(reg));
+		emit({ 0x0f, static_cast<uint8>(0x90 | cond) });
+		modrm_reg(0, reg);
+	}
+	void add8(Reg reg, uint8 value) {
+		rex(false, 0, 0, reg, needs_rex_byte(reg));
+		emit({ 0x80 });
+		modrm_reg(0, reg);
+		emit_imm(value);
+	}
+	void lahf() { emit({ 0x9f }); }
+	void sahf() { emit({ 0x9e }); }
+	void cmc() { emit({ 0xf5 }); }
+};
+
+}
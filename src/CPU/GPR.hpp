@@ -3,10 +3,17 @@
 
 /*
  *  General purpose registers
+ *
+ *  The registers visible in the current mode live in a flat array, so that
+ *  instructions can access them with a plain index. The banked copies of all
+ *  other modes are only touched when the mode changes.
  */
 struct GPR {
-	//  System/User instruction_mode registers
-	uint32 m_base[16];
+	//  R0-R15 of the current mode
+	uint32 m_active[16];
+
+	//  R8-R14 System/User mode regs, while another mode is active
+	uint32 m_gUSR[7];
 
 	//  R8-R14 FIQ regs
 	uint32 m_gFIQ[7];
@@ -22,4 +29,4 @@ struct GPR {
 
 	//  R13-R14 UND regs
 	uint32 m_gUND[2];
-};
\ No newline at end of file
+};
@@ -0,0 +1,488 @@
+#include <cmath>
+#include <fmt/format.h>
+#include <numbers>
+#include <vector>
+#include "Bus/Common/BusInterface.hpp"
+#include "Bus/Common/MemoryLayout.hpp"
+#include "Bus/IO/IOContainer.hpp"
+#include "CPU/ARM7TDMI.hpp"
+#include "Emulator/Config.hpp"
+#include "Emulator/GaBber.hpp"
+
+/*
+ *  Native implementations of the BIOS calls that games use in hot paths.
+ *  Cycle charges are approximations of the real BIOS routines.
+ */
+enum class BiosCall : uint8 {
+	RegisterRamReset = 0x01,
+	Halt = 0x02,
+	IntrWait = 0x04,
+	VBlankIntrWait = 0x05,
+	Div = 0x06,
+	DivArm = 0x07,
+	Sqrt = 0x08,
+	CpuSet = 0x0B,
+	CpuFastSet = 0x0C,
+	BgAffineSet = 0x0E,
+	ObjAffineSet = 0x0F,
+	BitUnPack = 0x10,
+	LZ77UnCompWram = 0x11,
+	LZ77UnCompVram = 0x12,
+	HuffUnComp = 0x13,
+	RLUnCompWram = 0x14,
+	RLUnCompVram = 0x15,
+};
+
+//  Address of the interrupt flags acknowledged by user IRQ handlers
+static constexpr uint32 bios_irq_flags = 0x03007FF8;
+
+static constexpr bool is_hle_supported(uint8 number) {
+	switch(static_cast<BiosCall>(number)) {
+		case BiosCall::RegisterRamReset:
+		case BiosCall::Halt:
+		case BiosCall::IntrWait:
+		case BiosCall::VBlankIntrWait:
+		case BiosCall::Div:
+		case BiosCall::DivArm:
+		case BiosCall::Sqrt:
+		case BiosCall::CpuSet:
+		case BiosCall::CpuFastSet:
+		case BiosCall::BgAffineSet:
+		case BiosCall::ObjAffineSet:
+		case BiosCall::BitUnPack:
+		case BiosCall::LZ77UnCompWram:
+		case BiosCall::LZ77UnCompVram:
+		case BiosCall::HuffUnComp:
+		case BiosCall::RLUnCompWram:
+		case BiosCall::RLUnCompVram: return true;
+		default: return false;
+	}
+}
+
+uint64 ARM7TDMI::hle_supported_swis() {
+	uint64 mask = 0;
+	for(unsigned number = 0; number < 64; ++number) {
+		if(is_hle_supported(number)) {
+			mask |= 1ull << number;
+		}
+	}
+	return mask;
+}
+
+bool ARM7TDMI::hle_swi(uint8 number) {
+	const bool enabled = config().bios_hle && number < 64 && (config().bios_hle_swis & (1ull << number));
+	if(!enabled || !is_hle_supported(number)) {
+		if(!mem().bios.is_hle_stub()) {
+			return false;
+		}
+		//  The stub BIOS would return without doing anything, stop on the SWI instead
+		fmt::print("HLE/ Unimplemented SWI {:02x} at {:08x} without a BIOS image\n", number,
+		           const_pc() - 2 * current_instr_len());
+		pc() = const_pc() - 2 * current_instr_len();
+		m_emu.enter_debug_mode();
+		return true;
+	}
+
+	//  Entering and leaving the BIOS call
+	m_wait_cycles += 20;
+
+	switch(static_cast<BiosCall>(number)) {
+		case BiosCall::RegisterRamReset: hle_register_ram_reset(reg(0)); break;
+		case BiosCall::Halt: io().haltcnt.m_halt = true; break;
+		case BiosCall::IntrWait: hle_intr_wait(reg(0) != 0, reg(1)); break;
+		case BiosCall::VBlankIntrWait: hle_intr_wait(true, 1u << static_cast<unsigned>(IRQType::VBlank)); break;
+		case BiosCall::Div: hle_div(static_cast<int32>(reg(0)), static_cast<int32>(reg(1))); break;
+		case BiosCall::DivArm: hle_div(static_cast<int32>(reg(1)), static_cast<int32>(reg(0))); break;
+		case BiosCall::Sqrt: {
+			reg(0) = static_cast<uint32>(std::sqrt(static_cast<double>(reg(0))));
+			m_wait_cycles += 30;
+			break;
+		}
+		case BiosCall::CpuSet: hle_cpu_set(reg(0), reg(1), reg(2)); break;
+		case BiosCall::CpuFastSet: hle_cpu_fast_set(reg(0), reg(1), reg(2)); break;
+		case BiosCall::BgAffineSet: hle_bg_affine_set(reg(0), reg(1), reg(2)); break;
+		case BiosCall::ObjAffineSet: hle_obj_affine_set(reg(0), reg(1), reg(2), reg(3)); break;
+		case BiosCall::BitUnPack: hle_bit_unpack(reg(0), reg(1), reg(2)); break;
+		case BiosCall::LZ77UnCompWram: hle_lz77_uncomp(reg(0), reg(1), false); break;
+		case BiosCall::LZ77UnCompVram: hle_lz77_uncomp(reg(0), reg(1), true); break;
+		case BiosCall::HuffUnComp: hle_huff_uncomp(reg(0), reg(1)); break;
+		case BiosCall::RLUnCompWram: hle_rl_uncomp(reg(0), reg(1), false); break;
+		case BiosCall::RLUnCompVram: hle_rl_uncomp(reg(0), reg(1), true); break;
+		default: ASSERT_NOT_REACHED();
+	}
+	return true;
+}
+
+/*
+ *  Waits until one of the requested interrupts was acknowledged by the IRQ
+ *  handler. Instead of looping inside the BIOS, the CPU is halted and the SWI
+ *  instruction is executed again once an interrupt wakes it up.
+ */
+void ARM7TDMI::hle_intr_wait(bool discard_old, uint16 flags) {
+	*io().ime = 1;
+	const uint16 raised = mem_read16(bios_irq_flags);
+	if(discard_old && !m_hle_intr_waiting) {
+		mem_write16(bios_irq_flags, raised & ~flags);
+	} else if(raised & flags) {
+		mem_write16(bios_irq_flags, raised & ~flags);
+		m_hle_intr_waiting = false;
+		return;
+	}
+
+	m_hle_intr_waiting = true;
+	io().haltcnt.m_halt = true;
+	pc() = const_pc() - 2 * current_instr_len();
+}
+
+void ARM7TDMI::hle_div(int32 numerator, int32 denominator) {
+	m_wait_cycles += 50;
+	if(denominator == 0) {
+		reg(0) = numerator < 0 ? -1 : 1;
+		reg(1) = numerator;
+		reg(3) = 1;
+		return;
+	}
+
+	const auto quotient = static_cast<int32>(static_cast<int64>(numerator) / denominator);
+	const auto remainder = static_cast<int32>(static_cast<int64>(numerator) % denominator);
+	reg(0) = quotient;
+	reg(1) = remainder;
+	reg(3) = quotient < 0 ? 0u - static_cast<uint32>(quotient) : static_cast<uint32>(quotient);
+}
+
+void ARM7TDMI::hle_cpu_set(uint32 source, uint32 destination, uint32 control) {
+	//  The BIOS refuses to copy from its own memory
+	if((source & 0x0E000000) == 0) {
+		return;
+	}
+
+	const uint32 count = control & 0x1FFFFF;
+	const bool fill = control & (1u << 24u);
+	const bool word = control & (1u << 26u);
+	const uint32 step = word ? 4 : 2;
+	source &= ~(step - 1);
+	destination &= ~(step - 1);
+
+	for(uint32 i = 0; i < count; ++i) {
+		const uint32 from = fill ? source : source + i * step;
+		const uint32 to = destination + i * step;
+		if(word) {
+			mem_write32(to, mem_read32(from));
+			m_wait_cycles += mem_waits_access32(from, AccessType::Seq) + mem_waits_access32(to, AccessType::Seq);
+		} else {
+			mem_write16(to, mem_read16(from));
+			m_wait_cycles += mem_waits_access16(from, AccessType::Seq) + mem_waits_access16(to, AccessType::Seq);
+		}
+	}
+}
+
+void ARM7TDMI::hle_cpu_fast_set(uint32 source, uint32 destination, uint32 control) {
+	if((source & 0x0E000000) == 0) {
+		return;
+	}
+
+	//  Transfers are done in blocks of 8 words
+	const uint32 count = ((control & 0x1FFFFF) + 7) & ~7u;
+	const bool fill = control & (1u << 24u);
+	source &= ~3u;
+	destination &= ~3u;
+
+	const uint32 fill_value = fill ? mem_read32(source) : 0;
+	for(uint32 i = 0; i < count; ++i) {
+		const uint32 to = destination + i * 4;
+		mem_write32(to, fill ? fill_value : mem_read32(source + i * 4));
+		m_wait_cycles += mem_waits_access32(to, AccessType::Seq);
+		if(!fill) {
+			m_wait_cycles += mem_waits_access32(source + i * 4, AccessType::Seq);
+		}
+	}
+}
+
+/*
+ *  Writes decompressed data to the bus. VRAM does not support byte writes,
+ *  so the VRAM variants only write whole halfwords.
+ */
+void ARM7TDMI::hle_write_uncompressed(uint32 destination, std::vector<uint8> const& data, bool vram) {
+	size_t i = 0;
+	for(; i + 4 <= data.size() && (destination + i) % 4 == 0; i += 4) {
+		const uint32 value = data[i] | (data[i + 1] << 8u) | (data[i + 2] << 16u) | (data[i + 3] << 24u);
+		mem_write32(destination + i, value);
+	}
+	for(; i + 2 <= data.size(); i += 2) {
+		mem_write16(destination + i, data[i] | (data[i + 1] << 8u));
+	}
+	if(i < data.size() && !vram) {
+		mem_write8(destination + i, data[i]);
+	}
+	//  Decompression in the BIOS takes a few cycles per byte on top of the writes
+	m_wait_cycles += data.size() * 4;
+}
+
+void ARM7TDMI::hle_lz77_uncomp(uint32 source, uint32 destination, bool vram) {
+	const uint32 header = mem_read32(source & ~3u);
+	const uint32 size = header >> 8u;
+	uint32 address = (source & ~3u) + 4;
+
+	std::vector<uint8> data;
+	data.reserve(size);
+	while(data.size() < size) {
+		const uint8 flags = mem_read8(address++);
+		for(unsigned bit = 0; bit < 8 && data.size() < size; ++bit) {
+			if(!(flags & (0x80u >> bit))) {
+				data.push_back(mem_read8(address++));
+				continue;
+			}
+
+			const uint8 b0 = mem_read8(address++);
+			const uint8 b1 = mem_read8(address++);
+			const uint32 displacement = (((b0 & 0xFu) << 8u) | b1) + 1;
+			const uint32 length = (b0 >> 4u) + 3;
+			for(uint32 i = 0; i < length && data.size() < size; ++i) {
+				//  Malformed streams may point before the start of the output
+				const uint8 value = displacement <= data.size() ? data[data.size() - displacement] : 0;
+				data.push_back(value);
+			}
+		}
+	}
+
+	hle_write_uncompressed(destination, data, vram);
+}
+
+void ARM7TDMI::hle_rl_uncomp(uint32 source, uint32 destination, bool vram) {
+	const uint32 header = mem_read32(source & ~3u);
+	const uint32 size = header >> 8u;
+	uint32 address = (source & ~3u) + 4;
+
+	std::vector<uint8> data;
+	data.reserve(size);
+	while(data.size() < size) {
+		const uint8 flag = mem_read8(address++);
+		if(flag & 0x80u) {
+			const uint32 length = (flag & 0x7Fu) + 3;
+			const uint8 value = mem_read8(address++);
+			for(uint32 i = 0; i < length && data.size() < size; ++i) {
+				data.push_back(value);
+			}
+		} else {
+			const uint32 length = (flag & 0x7Fu) + 1;
+			for(uint32 i = 0; i < length && data.size() < size; ++i) {
+				data.push_back(mem_read8(address++));
+			}
+		}
+	}
+
+	hle_write_uncompressed(destination, data, vram);
+}
+
+void ARM7TDMI::hle_huff_uncomp(uint32 source, uint32 destination) {
+	const uint32 header = mem_read32(source & ~3u);
+	const uint32 size = header >> 8u;
+	const unsigned data_bits = header & 0xFu;
+	if(data_bits != 4 && data_bits != 8) {
+		return;
+	}
+
+	const uint32 tree = (source & ~3u) + 4;
+	const uint32 root = tree + 1;
+	uint32 bitstream = tree + (mem_read8(tree) + 1) * 2;
+
+	std::vector<uint8> data;
+	data.reserve(size);
+	uint32 node = root;
+	uint32 pending = 0;
+	unsigned pending_bits = 0;
+	while(data.size() < size) {
+		const uint32 bits = mem_read32(bitstream);
+		bitstream += 4;
+		for(int bit = 31; bit >= 0 && data.size() < size; --bit) {
+			const bool right = (bits >> bit) & 1u;
+			const uint8 value = mem_read8(node);
+			const uint32 child = (node & ~1u) + (value & 0x3Fu) * 2 + 2 + (right ? 1 : 0);
+			const bool is_data = right ? (value & 0x40u) : (value & 0x80u);
+			if(!is_data) {
+				node = child;
+				continue;
+			}
+
+			pending |= mem_read8(child) << pending_bits;
+			pending_bits += data_bits;
+			node = root;
+			if(pending_bits == 32) {
+				for(unsigned i = 0; i < 4; ++i) {
+					data.push_back((pending >> (i * 8)) & 0xFFu);
+				}
+				pending = 0;
+				pending_bits = 0;
+			}
+		}
+	}
+
+	//  Huffman output is always written in words
+	data.resize(size & ~3u);
+	hle_write_uncompressed(destination & ~3u, data, true);
+}
+
+void ARM7TDMI::hle_fill32(uint32 destination, uint32 size) {
+	for(uint32 i = 0; i < size; i += 4) {
+		mem_write32(destination + i, 0);
+		m_wait_cycles += mem_waits_access32(destination + i, AccessType::Seq);
+	}
+}
+
+/*
+ *  Clears the memory regions and register groups selected by the flags. The
+ *  last 0x200 bytes of IWRAM hold the stacks and the IRQ handler address,
+ *  and are never cleared. There are no serial registers to reset.
+ */
+void ARM7TDMI::hle_register_ram_reset(uint8 flags) {
+	auto clear_registers = [this](uint32 first, uint32 last) {
+		for(uint32 address = first; address < last; address += 2) {
+			mem_write16(address, 0);
+		}
+	};
+
+	mem_write16(0x04000000, 0x0080);
+	if(flags & 0x01u) {
+		hle_fill32(0x02000000, 256 * kB);
+	}
+	if(flags & 0x02u) {
+		hle_fill32(0x03000000, 32 * kB - 0x200);
+	}
+	if(flags & 0x04u) {
+		hle_fill32(0x05000000, 1 * kB);
+	}
+	if(flags & 0x08u) {
+		hle_fill32(0x06000000, 96 * kB);
+	}
+	if(flags & 0x10u) {
+		hle_fill32(0x07000000, 1 * kB);
+	}
+	if(flags & 0x40u) {
+		//  Sound channels, wave RAM and FIFOs, keeping the bias
+		clear_registers(0x04000060, 0x04000082);
+		clear_registers(0x04000084, 0x04000086);
+		clear_registers(0x04000090, 0x040000A8);
+	}
+	if(flags & 0x80u) {
+		//  Display, DMA, timers, keypad and interrupt control
+		clear_registers(0x04000002, 0x04000056);
+		clear_registers(0x040000B0, 0x040000E0);
+		clear_registers(0x04000100, 0x04000110);
+		clear_registers(0x04000132, 0x04000134);
+		clear_registers(0x04000200, 0x04000202);
+		clear_registers(0x04000204, 0x0400020A);
+	}
+}
+
+//  The BIOS uses only the upper 8 bits of the angle
+static double bios_angle(uint16 angle) {
+	return (angle >> 8u) * std::numbers::pi / 128.0;
+}
+
+static uint16 to_fixed16(double value) {
+	return static_cast<uint16>(static_cast<int32>(value * 256.0));
+}
+
+static uint32 to_fixed32(double value) {
+	return static_cast<uint32>(static_cast<int32>(value * 256.0));
+}
+
+void ARM7TDMI::hle_bg_affine_set(uint32 source, uint32 destination, uint32 count) {
+	for(uint32 i = 0; i < count; ++i, source += 20, destination += 16) {
+		const double origin_x = static_cast<int32>(mem_read32(source)) / 256.0;
+		const double origin_y = static_cast<int32>(mem_read32(source + 4)) / 256.0;
+		const double center_x = static_cast<int16>(mem_read16(source + 8));
+		const double center_y = static_cast<int16>(mem_read16(source + 10));
+		const double scale_x = static_cast<int16>(mem_read16(source + 12)) / 256.0;
+		const double scale_y = static_cast<int16>(mem_read16(source + 14)) / 256.0;
+		const double angle = bios_angle(mem_read16(source + 16));
+
+		const double pa = std::cos(angle) * scale_x;
+		const double pb = -std::sin(angle) * scale_x;
+		const double pc = std::sin(angle) * scale_y;
+		const double pd = std::cos(angle) * scale_y;
+		mem_write16(destination, to_fixed16(pa));
+		mem_write16(destination + 2, to_fixed16(pb));
+		mem_write16(destination + 4, to_fixed16(pc));
+		mem_write16(destination + 6, to_fixed16(pd));
+		mem_write32(destination + 8, to_fixed32(origin_x - (pa * center_x + pb * center_y)));
+		mem_write32(destination + 12, to_fixed32(origin_y - (pc * center_x + pd * center_y)));
+		m_wait_cycles += 60;
+	}
+}
+
+/*
+ *  The stride separates the four parameters of each matrix in the
+ *  destination, it is 2 for a packed array and 8 for OAM.
+ */
+void ARM7TDMI::hle_obj_affine_set(uint32 source, uint32 destination, uint32 count, uint32 stride) {
+	for(uint32 i = 0; i < count; ++i, source += 8, destination += 4 * stride) {
+		const double scale_x = static_cast<int16>(mem_read16(source)) / 256.0;
+		const double scale_y = static_cast<int16>(mem_read16(source + 2)) / 256.0;
+		const double angle = bios_angle(mem_read16(source + 4));
+
+		mem_write16(destination, to_fixed16(std::cos(angle) * scale_x));
+		mem_write16(destination + stride, to_fixed16(-std::sin(angle) * scale_x));
+		mem_write16(destination + 2 * stride, to_fixed16(std::sin(angle) * scale_y));
+		mem_write16(destination + 3 * stride, to_fixed16(std::cos(angle) * scale_y));
+		m_wait_cycles += 40;
+	}
+}
+
+/*
+ *  Widens every source unit to the destination width. Non-zero units, or
+ *  all units if bit 31 of the offset is set, have the offset added.
+ */
+void ARM7TDMI::hle_bit_unpack(uint32 source, uint32 destination, uint32 info) {
+	const uint32 length = mem_read16(info);
+	const unsigned source_width = mem_read8(info + 2);
+	const unsigned destination_width = mem_read8(info + 3);
+	const uint32 offset = mem_read32(info + 4);
+	const bool offset_zero = offset & (1u << 31u);
+
+	const auto valid_width = [](unsigned width, unsigned max) {
+		return width != 0 && width <= max && (width & (width - 1)) == 0;
+	};
+	if(!valid_width(source_width, 8) || !valid_width(destination_width, 32)) {
+		return;
+	}
+
+	destination &= ~3u;
+	uint32 pending = 0;
+	unsigned pending_bits = 0;
+	for(uint32 i = 0; i < length; ++i) {
+		const uint8 byte = mem_read8(source + i);
+		for(unsigned bit = 0; bit < 8; bit += source_width) {
+			uint32 unit = (byte >> bit) & ((1u << source_width) - 1);
+			if(unit != 0 || offset_zero) {
+				unit += offset & 0x7FFFFFFFu;
+			}
+			pending |= unit << pending_bits;
+			pending_bits += destination_width;
+			if(pending_bits == 32) {
+				mem_write32(destination, pending);
+				m_wait_cycles += mem_waits_access32(destination, AccessType::Seq);
+				destination += 4;
+				pending = 0;
+				pending_bits = 0;
+			}
+		}
+	}
+	m_wait_cycles += length * 4;
+}
+
+/*
+ *  Sets up the state the BIOS leaves behind after booting, and jumps
+ *  straight to the cartridge entry point.
+ */
+void ARM7TDMI::hle_boot() {
+	bank_slot(PRIV_MODE::IRQ, 13) = 0x03007FA0;
+	const auto previous = cspr().mode();
+	r13() = 0x03007FE0;
+	cspr().set_mode(PRIV_MODE::SYS);
+	swap_register_bank(previous);
+	r13() = 0x03007F00;
+	cspr().set(CSPR_REGISTERS::IRQn, false);
+	pc() = 0x08000000 + 8;
+	m_pc_dirty = false;
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <utility>
+#include "Bus/Common/BusInterface.hpp"
+#include "CPU/ARM7TDMI.hpp"
+#include "Emulator/Config.hpp"
+#include "Emulator/Scheduler.hpp"
+
+static bool arm_is_side_effect_free(uint32 opcode) {
+	using disarmv4t::arm::InstructionType;
+	const bool load = opcode & (1u << 20u);
+	const auto rd = (opcode >> 12u) & 0xfu;
+	switch(disarmv4t::arm::decode_fast(opcode)) {
+		case InstructionType::ALU: return rd != 15;
+		case InstructionType::MUL:
+		case InstructionType::MLL: return true;
+		case InstructionType::SDT:
+		case InstructionType::HDT: return load && rd != 15;
+		case InstructionType::BDT: return load && !(opcode & (1u << 15u));
+		//  Plain branches only, BL would modify LR on every iteration
+		case InstructionType::BBL: return !(opcode & (1u << 24u));
+		default: return false;
+	}
+}
+
+static bool thumb_is_side_effect_free(uint16 opcode) {
+	using disarmv4t::thumb::InstructionType;
+	const bool load = opcode & (1u << 11u);
+	switch(disarmv4t::thumb::decode(opcode)) {
+		case InstructionType::FMT1:
+		case InstructionType::FMT2:
+		case InstructionType::FMT3:
+		case InstructionType::FMT4:
+		case InstructionType::FMT6:
+		case InstructionType::FMT12:
+		case InstructionType::FMT13:
+		case InstructionType::FMT16:
+		case InstructionType::FMT18: return true;
+		case InstructionType::FMT5: {
+			const auto op = (opcode >> 8u) & 3u;
+			const auto rd = ((opcode >> 4u) & 8u) | (opcode & 7u);
+			return op != 3 && (op == 1 || rd != 15);
+		}
+		//  STRH is the only store in this format
+		case InstructionType::FMT8: return (opcode & 0x0c00) != 0;
+		case InstructionType::FMT7:
+		case InstructionType::FMT9:
+		case InstructionType::FMT10:
+		case InstructionType::FMT11:
+		case InstructionType::FMT15: return load;
+		//  POP without PC
+		case InstructionType::FMT14: return load && !(opcode & (1u << 8u));
+		default: return false;
+	}
+}
+
+bool ARM7TDMI::idle_loop_is_side_effect_free(uint32 head, uint32 tail, bool thumb) const {
+	for(uint32 address = head; address <= tail; address += thumb ? 2 : 4) {
+		const bool ok = thumb ? thumb_is_side_effect_free(bus().read16(address))
+		                      : arm_is_side_effect_free(bus().read32(address));
+		if(!ok) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ *  Called after a branch was taken from the given address.
+ */
+void ARM7TDMI::idle_loop_check(uint32 branch_address) {
+	const bool timer_polled = std::exchange(m_timer_polled, false);
+	const bool thumb = cspr().state() == INSTR_MODE::THUMB;
+	const uint32 head = const_pc() - 2 * current_instr_len();
+	if(head > branch_address || branch_address - head > max_idle_loop_bytes) {
+		return;
+	}
+
+	std::array<uint32, 17> state {};
+	for(unsigned i = 0; i < 15; ++i) {
+		state[i] = creg(i);
+	}
+	state[15] = const_pc();
+	state[16] = cspr().raw();
+
+	auto& loop = m_idle_loop;
+	if(loop.head != head || loop.tail != branch_address || loop.thumb != thumb) {
+		loop = { head, branch_address, thumb, idle_loop_is_side_effect_free(head, branch_address, thumb), state };
+		return;
+	}
+
+	//  An iteration without any observable progress. The timer counter can
+	//  change on any prescaler tick, which is not a scheduled event.
+	if(loop.side_effect_free && !timer_polled && loop.state == state) {
+		m_idle = true;
+	}
+	loop.state = state;
+}
+
+unsigned ARM7TDMI::cycles_to_next_event() const {
+	const uint64 now = scheduler().now() + m_wait_cycles;
+	const uint64 deadline = scheduler().next_deadline();
+	const uint64 cycles = deadline > now ? deadline - now : 0;
+	return static_cast<unsigned>(std::min<uint64>(cycles, std::numeric_limits<unsigned>::max()));
+}
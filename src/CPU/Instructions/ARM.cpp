@@ -59,7 +59,7 @@ void ARM7TDMI::DPI(arm::DataProcessInstruction instr) {
 	if(instr.destination_reg() == 15 && instr.should_set_condition()) {
 		auto v = spsr();
 		if(v.has_value()) {
-			cspr() = *spsr();
+			set_cspr(*v);
 			//			log("Leaving exception, pc={:08x}, cspr={:08x}", const_pc(), cspr().raw());
 		}
 	}
@@ -167,7 +167,9 @@ void ARM7TDMI::CMN(arm::DataProcessInstruction instr) {
 
 			if(!v.has_value()) {
 				log("Undefined behavior: SPSR access in mode with no visible SPSR!");
+				const auto previous = cspr().mode();
 				cspr().set_raw(source);
+				swap_register_bank(previous);
 			} else {
 				v->get().set_raw(source);
 			}
@@ -177,7 +179,9 @@ void ARM7TDMI::CMN(arm::DataProcessInstruction instr) {
 
 			if(!v.has_value()) {
 				log("Undefined behavior: SPSR access in mode with no visible SPSR!");
+				const auto previous = cspr().mode();
 				cspr().set_raw(imm);
+				swap_register_bank(previous);
 			} else {
 				v->get().set_raw(imm);
 			}
@@ -235,7 +239,9 @@ void ARM7TDMI::TEQ(arm::DataProcessInstruction instr) {
 		const uint32 value = !instr.immediate_is_value() ? creg(instr.operand2_reg()) : evaluate_operand2(instr, false);
 		auto mask = instr.operand1_reg();
 		bool f = (mask & 0b1000), s = (mask & 0b0100), x = (mask & 0b0010), c = (mask & 0b0001);
+		const auto previous = cspr().mode();
 		cspr().set_flags(value, f, s, x, c);
+		swap_register_bank(previous);
 
 		return;
 	}
@@ -475,7 +481,12 @@ void ARM7TDMI::SWP(arm::SWPInstruction instr) {
 	}
 }
 
-void ARM7TDMI::SWI(arm::SWIInstruction) {
+void ARM7TDMI::SWI(arm::SWIInstruction instr) {
+	//  The BIOS takes the call number from bits 16-23 of the comment field
+	if(hle_swi((instr.comment() >> 16u) & 0xFFu)) {
+		m_wait_cycles += mem_waits_access32(const_pc(), AccessType::Seq);
+		return;
+	}
 	enter_swi();
 }
 
@@ -567,20 +578,20 @@ void ARM7TDMI::BDT(arm::BDTInstruction instr) {
 		if(instr.load_from_memory()) {
 			uint32 word = mem_read32(address & ~3u);
 
-			uint32& gpr = (instr.PSR() ? m_registers.m_base[reg] : this->reg(reg));
+			uint32& gpr = (instr.PSR() ? user_reg(reg) : this->reg(reg));
 			gpr = word;
 
 			if(instr.PSR() && reg == 15) {
 				auto v = spsr();
 				if(v.has_value())
-					cspr() = *spsr();
+					set_cspr(*v);
 				else
 					log("Undefined behavior: LDM - SPSR access in mode with no visible SPSR!");
 			}
 		} else {
 			const auto offset_for_r15 = ((reg == 15) ? 4 : 0);
 
-			uint32 word = (instr.PSR() ? m_registers.m_base[reg] : this->creg(reg));
+			uint32 word = (instr.PSR() ? user_reg(reg) : this->creg(reg));
 			//  Quirk with writeback and base in Rlist
 			if(instr.writeback() && reg == instr.base_reg() && !instr.is_register_first_in_rlist(instr.base_reg())) {
 				word = base + instr.total_offset();
@@ -612,3 +623,48 @@ void ARM7TDMI::BDT(arm::BDTInstruction instr) {
 		                 mem_waits_access32(const_pc() + 12, AccessType::NonSeq);
 	}
 }
+
+template<disarmv4t::arm::InstructionType type>
+void ARM7TDMI::ARM_dispatch(uint32 opcode) {
+	using disarmv4t::arm::InstructionType;
+
+	if(!cspr().evaluate_condition(arm::Instruction(opcode).condition())) {
+		//  Unevaluated instructions take one S-cycle
+		m_wait_cycles += mem_waits_access32(const_pc(), AccessType::Seq);
+		return;
+	}
+
+	if constexpr(type == InstructionType::BBL) {
+		B(arm::BInstruction(opcode));
+	} else if constexpr(type == InstructionType::BX) {
+		BX(arm::BXInstruction(opcode));
+	} else if constexpr(type == InstructionType::ALU) {
+		DPI(arm::DataProcessInstruction(opcode));
+	} else if constexpr(type == InstructionType::MUL) {
+		MUL(arm::MultInstruction(opcode));
+	} else if constexpr(type == InstructionType::MLL) {
+		MLL(arm::MultLongInstruction(opcode));
+	} else if constexpr(type == InstructionType::SDT) {
+		SDT(arm::SDTInstruction(opcode));
+	} else if constexpr(type == InstructionType::HDT) {
+		HDT(arm::HDTInstruction(opcode));
+	} else if constexpr(type == InstructionType::BDT) {
+		BDT(arm::BDTInstruction(opcode));
+	} else if constexpr(type == InstructionType::SWP) {
+		SWP(arm::SWPInstruction(opcode));
+	} else if constexpr(type == InstructionType::SWI) {
+		SWI(arm::SWIInstruction(opcode));
+	} else {
+		ARM_undefined(opcode);
+	}
+}
+
+template<size_t... types>
+constexpr std::array<ARM7TDMI::ArmHandler, sizeof...(types)>
+ARM7TDMI::make_arm_handlers(std::index_sequence<types...>) {
+	return { &ARM7TDMI::ARM_dispatch<static_cast<disarmv4t::arm::InstructionType>(types)>... };
+}
+
+const std::array<ARM7TDMI::ArmHandler, static_cast<size_t>(disarmv4t::arm::InstructionType::_end)>
+        ARM7TDMI::s_arm_handlers =
+                make_arm_handlers(std::make_index_sequence<static_cast<size_t>(disarmv4t::arm::InstructionType::_end)>());
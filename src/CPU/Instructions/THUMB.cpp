@@ -4,12 +4,13 @@
 
 namespace thumb = disarmv4t::thumb::instr;
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_ALU(thumb::InstructionFormat4 instr) {
 	/*
 	 *  Lookup table for THUMB format 4 instruction (ALU operations)
 	 */
 	typedef void (::ARM7TDMI::*ThumbAluOperation)(::thumb::InstructionFormat4);
-	static const ThumbAluOperation s_thumb_alu_lookup[16] {
+	constexpr ThumbAluOperation s_thumb_alu_lookup[16] {
 		&ARM7TDMI::THUMB_AND, &ARM7TDMI::THUMB_EOR, &ARM7TDMI::THUMB_LSL, &ARM7TDMI::THUMB_LSR,
 		&ARM7TDMI::THUMB_ASR, &ARM7TDMI::THUMB_ADC, &ARM7TDMI::THUMB_SBC, &ARM7TDMI::THUMB_ROR,
 		&ARM7TDMI::THUMB_TST, &ARM7TDMI::THUMB_NEG, &ARM7TDMI::THUMB_CMP, &ARM7TDMI::THUMB_CMN,
@@ -17,138 +18,128 @@ void ARM7TDMI::THUMB_ALU(thumb::InstructionFormat4 instr) {
 	};
 
 	m_wait_cycles += mem_waits_access16(const_pc() + 4, AccessType::Seq);
-	auto func = s_thumb_alu_lookup[instr.opcode()];
+	constexpr auto func = s_thumb_alu_lookup[thumb::InstructionFormat4(bits << 6u).opcode()];
 	(*this.*func)(instr);
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT1(thumb::InstructionFormat1 instr) {
+	constexpr thumb::InstructionFormat1 known(bits << 6u);
+	static_assert(known.opcode() != 3, "Opcode 3 is format 2");
+
 	const auto& source = creg(instr.source_reg());
 	auto& destination = reg(instr.destination_reg());
 	const auto offset = instr.immediate();
-	const auto opcode = instr.opcode();
 
-	switch(opcode) {
-		case 0: {
-			destination = _alu_lsl(source, offset);
-			break;
-		}
-		case 1: {
-			destination = _alu_lsr(source, offset);
-			break;
-		}
-		case 2: {
-			destination = _alu_asr(source, offset);
-			break;
-		}
-		default: {
-			log("ARM7TDMI/ Invalid opcode {:04x} for THUMB mov shifted at pc {:08x}, instr {:04x}", opcode, pc() - 4,
-			    instr.raw());
-			break;
-		}
+	if constexpr(known.opcode() == 0) {
+		destination = _alu_lsl(source, offset);
+	} else if constexpr(known.opcode() == 1) {
+		destination = _alu_lsr(source, offset);
+	} else {
+		destination = _alu_asr(source, offset);
 	}
 
 	m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT2(thumb::InstructionFormat2 instr) {
+	constexpr thumb::InstructionFormat2 known(bits << 6u);
+
 	const auto& source = creg(instr.source_reg());
 	auto& destination = reg(instr.destination_reg());
 
-	uint32 operand2 = (instr.immediate_is_value()) ? (instr.immediate()) : (creg(instr.immediate()));
+	uint32 operand2;
+	if constexpr(known.immediate_is_value()) {
+		operand2 = instr.immediate();
+	} else {
+		operand2 = creg(instr.immediate());
+	}
 
-	const uint32 result = (instr.subtract()) ? _alu_sub(source, operand2, true) : _alu_add(source, operand2, true);
+	uint32 result;
+	if constexpr(known.subtract()) {
+		result = _alu_sub(source, operand2, true);
+	} else {
+		result = _alu_add(source, operand2, true);
+	}
 
 	destination = result;
 
 	m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT3(thumb::InstructionFormat3 instr) {
-	switch(instr.opcode()) {
-		case 0: {//  MOV
-			auto& target_reg = reg(instr.target_reg());
-			target_reg = instr.immediate();
-			_alu_set_flags_logical_op(instr.immediate());
-			break;
-		}
-		case 1: {//  CMP
-			const auto& target_reg = creg(instr.target_reg());
-			(void)_alu_sub(target_reg, instr.immediate(), true);
-			break;
-		}
-		case 2: {//  ADD
-			auto& target_reg = reg(instr.target_reg());
-			target_reg = _alu_add(target_reg, instr.immediate(), true);
-			break;
-		}
-		case 3: {//  SUB
-			auto& target_reg = reg(instr.target_reg());
-			target_reg = _alu_sub(target_reg, instr.immediate(), true);
-			break;
-		}
-		default: ASSERT_NOT_REACHED();
+	constexpr thumb::InstructionFormat3 known(bits << 6u);
+
+	if constexpr(known.opcode() == 0) {//  MOV
+		auto& target_reg = reg(instr.target_reg());
+		target_reg = instr.immediate();
+		_alu_set_flags_logical_op(instr.immediate());
+	} else if constexpr(known.opcode() == 1) {//  CMP
+		const auto& target_reg = creg(instr.target_reg());
+		(void)_alu_sub(target_reg, instr.immediate(), true);
+	} else if constexpr(known.opcode() == 2) {//  ADD
+		auto& target_reg = reg(instr.target_reg());
+		target_reg = _alu_add(target_reg, instr.immediate(), true);
+	} else {//  SUB
+		auto& target_reg = reg(instr.target_reg());
+		target_reg = _alu_sub(target_reg, instr.immediate(), true);
 	}
 
 	m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT5(thumb::InstructionFormat5 instr) {
+	constexpr thumb::InstructionFormat5 known(bits << 6u);
+
+	//  The high register bits are part of the dispatch index, so only
+	//  r8-r15 destinations need to check for writes to the PC
 	const auto& source = creg(instr.source_reg());
 
-	switch(instr.opcode()) {
-		case 0: {
-			m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
+	if constexpr(known.opcode() == 0) {
+		m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
 
-			auto& destination = reg(instr.destination_reg());
-			destination = source + destination;
+		auto& destination = reg(instr.destination_reg());
+		destination = source + destination;
 
-			if(instr.destination_reg() == 15) {
-				m_wait_cycles += mem_waits_access16(const_pc(), AccessType::NonSeq) +
-				                 mem_waits_access16(const_pc(), AccessType::Seq);
-			}
-			break;
+		if(known.MSBd() && instr.destination_reg() == 15) {
+			m_wait_cycles += mem_waits_access16(const_pc(), AccessType::NonSeq) +
+			                 mem_waits_access16(const_pc(), AccessType::Seq);
 		}
-		case 1: {
-			const auto& destination = creg(instr.destination_reg());
-			(void)_alu_sub(destination, source, true);
+	} else if constexpr(known.opcode() == 1) {
+		const auto& destination = creg(instr.destination_reg());
+		(void)_alu_sub(destination, source, true);
 
-			m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
-			break;
-		}
-		case 2: {
-			m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
+		m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
+	} else if constexpr(known.opcode() == 2) {
+		m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
 
-			auto& destination = reg(instr.destination_reg());
-			destination = source;
+		auto& destination = reg(instr.destination_reg());
+		destination = source;
 
-			if(instr.destination_reg() == 15) {
-				m_wait_cycles += mem_waits_access16(const_pc(), AccessType::NonSeq) +
-				                 mem_waits_access16(const_pc(), AccessType::Seq);
-			}
-			break;
+		if(known.MSBd() && instr.destination_reg() == 15) {
+			m_wait_cycles += mem_waits_access16(const_pc(), AccessType::NonSeq) +
+			                 mem_waits_access16(const_pc(), AccessType::Seq);
 		}
-		case 3: {
-			if(!instr.MSBd()) {
-				m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
-
-				cspr().set_state((source & 1) ? INSTR_MODE::THUMB : INSTR_MODE::ARM);
-				if(!(source & 1)) {
-					pc() = source & ~2u;
-				} else {
-					pc() = source & ~1u;
-				}
-
-				if(cspr().state() == INSTR_MODE::ARM) {
-					m_wait_cycles += mem_waits_access32(const_pc() + 0, AccessType::NonSeq) +
-					                 mem_waits_access32(const_pc() + 4, AccessType::Seq);
-				} else {
-					m_wait_cycles += mem_waits_access16(const_pc() + 0, AccessType::NonSeq) +
-					                 mem_waits_access16(const_pc() + 2, AccessType::Seq);
-				}
-			}
-			break;
+	} else if constexpr(!known.MSBd()) {
+		m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
+
+		cspr().set_state((source & 1) ? INSTR_MODE::THUMB : INSTR_MODE::ARM);
+		if(!(source & 1)) {
+			pc() = source & ~2u;
+		} else {
+			pc() = source & ~1u;
+		}
+
+		if(cspr().state() == INSTR_MODE::ARM) {
+			m_wait_cycles += mem_waits_access32(const_pc() + 0, AccessType::NonSeq) +
+			                 mem_waits_access32(const_pc() + 4, AccessType::Seq);
+		} else {
+			m_wait_cycles += mem_waits_access16(const_pc() + 0, AccessType::NonSeq) +
+			                 mem_waits_access16(const_pc() + 2, AccessType::Seq);
 		}
-		default: ASSERT_NOT_REACHED();
 	}
 }
 
@@ -162,15 +153,18 @@ void ARM7TDMI::THUMB_FMT6(thumb::InstructionFormat6 instr) {
 	                 mem_waits_access32(aligned_pc + immediate_shifted, AccessType::NonSeq);
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT7(thumb::InstructionFormat7 instr) {
+	constexpr thumb::InstructionFormat7 known(bits << 6u);
+
 	const auto& base = creg(instr.base_reg());
 	const auto& offset = creg(instr.offset_reg());
 
 	auto address = base + offset;
-	if(instr.load_from_memory()) {
+	if constexpr(known.load_from_memory()) {
 		auto& target = reg(instr.target_reg());
 
-		if(instr.quantity_in_bytes()) {
+		if constexpr(known.quantity_in_bytes()) {
 			target = mem_read8(address);
 			m_wait_cycles += mem_waits_access8(address, AccessType::NonSeq);
 		} else {
@@ -187,7 +181,7 @@ void ARM7TDMI::THUMB_FMT7(thumb::InstructionFormat7 instr) {
 	} else {
 		const auto target = creg(instr.target_reg());
 
-		if(instr.quantity_in_bytes()) {
+		if constexpr(known.quantity_in_bytes()) {
 			mem_write8(address, target & 0xFFu);
 			m_wait_cycles += mem_waits_access8(address, AccessType::NonSeq);
 		} else {
@@ -198,82 +192,77 @@ void ARM7TDMI::THUMB_FMT7(thumb::InstructionFormat7 instr) {
 	}
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT8(thumb::InstructionFormat8 instr) {
+	constexpr thumb::InstructionFormat8 known(bits << 6u);
+
 	const auto& base = creg(instr.base_reg());
 	const auto& offset = creg(instr.offset_reg());
 	const auto address = base + offset;
 
-	switch(instr.opcode()) {
-		case 0: {
-			const auto destination = creg(instr.destination_reg());
-			mem_write16(address & ~1u, destination & 0xffff);
-
-			m_wait_cycles += mem_waits_access16(address & ~1u, AccessType::NonSeq) +
-			                 mem_waits_access16(const_pc(), AccessType::NonSeq);
-			break;
-		}
-		case 1: {
-			auto& destination = reg(instr.destination_reg());
+	if constexpr(known.opcode() == 0) {
+		const auto destination = creg(instr.destination_reg());
+		mem_write16(address & ~1u, destination & 0xffff);
 
-			uint8 val = mem_read8(address);
-			destination = Bits::sign_extend<8>(val);
+		m_wait_cycles += mem_waits_access16(address & ~1u, AccessType::NonSeq) +
+		                 mem_waits_access16(const_pc(), AccessType::NonSeq);
+	} else if constexpr(known.opcode() == 1) {
+		auto& destination = reg(instr.destination_reg());
 
-			m_wait_cycles += 1 /*I*/ + mem_waits_access8(address, AccessType::NonSeq) +
-			                 mem_waits_access16(const_pc(), AccessType::Seq);
-			break;
-		}
-		case 2: {
-			auto& destination = reg(instr.destination_reg());
-
-			uint32 word;
-			word = static_cast<uint32>(mem_read16(address & ~1u));
-			if(address & 1u) {
-				log("Undefined behaviour: LDRH with unaligned address!");
-				word = Bits::rotr32(word, 8);
-			}
+		uint8 val = mem_read8(address);
+		destination = Bits::sign_extend<8>(val);
 
-			destination = word;
+		m_wait_cycles += 1 /*I*/ + mem_waits_access8(address, AccessType::NonSeq) +
+		                 mem_waits_access16(const_pc(), AccessType::Seq);
+	} else if constexpr(known.opcode() == 2) {
+		auto& destination = reg(instr.destination_reg());
 
-			m_wait_cycles += 1 /*I*/ + mem_waits_access16(address & ~1u, AccessType::NonSeq) +
-			                 mem_waits_access16(const_pc(), AccessType::Seq);
-			break;
+		uint32 word;
+		word = static_cast<uint32>(mem_read16(address & ~1u));
+		if(address & 1u) {
+			log("Undefined behaviour: LDRH with unaligned address!");
+			word = Bits::rotr32(word, 8);
 		}
-		case 3: {
-			auto& destination = reg(instr.destination_reg());
-
-			uint32 word;
-			if(address & 1u) {
-				log("Undefined behaviour: LDRSH with unaligned address!");
-				auto byte = mem_read8(address);
-				word = Bits::sign_extend<8>(byte);
-			} else {
-				auto hword = mem_read16(address);
-				word = Bits::sign_extend<16>(hword);
-			}
 
-			destination = word;
+		destination = word;
 
-			m_wait_cycles += 1 /*I*/ + mem_waits_access16(address, AccessType::NonSeq) +
-			                 mem_waits_access16(const_pc(), AccessType::Seq);
-			break;
+		m_wait_cycles += 1 /*I*/ + mem_waits_access16(address & ~1u, AccessType::NonSeq) +
+		                 mem_waits_access16(const_pc(), AccessType::Seq);
+	} else {
+		auto& destination = reg(instr.destination_reg());
+
+		uint32 word;
+		if(address & 1u) {
+			log("Undefined behaviour: LDRSH with unaligned address!");
+			auto byte = mem_read8(address);
+			word = Bits::sign_extend<8>(byte);
+		} else {
+			auto hword = mem_read16(address);
+			word = Bits::sign_extend<16>(hword);
 		}
 
-		default: ASSERT_NOT_REACHED();
+		destination = word;
+
+		m_wait_cycles += 1 /*I*/ + mem_waits_access16(address, AccessType::NonSeq) +
+		                 mem_waits_access16(const_pc(), AccessType::Seq);
 	}
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT9(thumb::InstructionFormat9 instr) {
+	constexpr thumb::InstructionFormat9 known(bits << 6u);
+
 	const auto& base = creg(instr.base_reg());
 
 	auto offset = static_cast<uint16>(instr.offset());
-	if(!instr.quantity_in_bytes())
+	if constexpr(!known.quantity_in_bytes())
 		offset <<= 2u;
 	uint32 address = base + offset;
 
-	if(instr.load_from_memory()) {
+	if constexpr(known.load_from_memory()) {
 		auto& target = reg(instr.target_reg());
 
-		if(instr.quantity_in_bytes()) {
+		if constexpr(known.quantity_in_bytes()) {
 			target = mem_read8(address);
 			m_wait_cycles += mem_waits_access8(address, AccessType::NonSeq);
 		} else {
@@ -291,7 +280,7 @@ void ARM7TDMI::THUMB_FMT9(thumb::InstructionFormat9 instr) {
 	} else {
 		const auto target = creg(instr.target_reg());
 
-		if(instr.quantity_in_bytes()) {
+		if constexpr(known.quantity_in_bytes()) {
 			mem_write8(address, target & 0xFFu);
 			m_wait_cycles += mem_waits_access8(address, AccessType::NonSeq);
 		} else {
@@ -302,12 +291,15 @@ void ARM7TDMI::THUMB_FMT9(thumb::InstructionFormat9 instr) {
 	}
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT10(thumb::InstructionFormat10 instr) {
+	constexpr thumb::InstructionFormat10 known(bits << 6u);
+
 	const auto& base = creg(instr.base_reg());
 	const auto offset = instr.offset() << 1u;
 	uint32 address = base + offset;
 
-	if(instr.load_from_memory()) {
+	if constexpr(known.load_from_memory()) {
 		auto& target = reg(instr.target_reg());
 
 		uint32 word;
@@ -331,10 +323,13 @@ void ARM7TDMI::THUMB_FMT10(thumb::InstructionFormat10 instr) {
 	}
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT11(thumb::InstructionFormat11 instr) {
+	constexpr thumb::InstructionFormat11 known(bits << 6u);
+
 	const auto address = creg(13) + (static_cast<uint16>(instr.immediate()) << 2u);
 
-	if(instr.load_from_memory()) {
+	if constexpr(known.load_from_memory()) {
 		auto& destination = reg(instr.destination_reg());
 
 		auto word = mem_read32(address & ~3u);//  Force align
@@ -358,11 +353,19 @@ void ARM7TDMI::THUMB_FMT11(thumb::InstructionFormat11 instr) {
 	}
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT12(thumb::InstructionFormat12 instr) {
+	constexpr thumb::InstructionFormat12 known(bits << 6u);
+
 	auto& destination = reg(instr.destination_reg());
 
 	const auto offset = static_cast<uint16>(instr.immediate()) << 2u;
-	auto address = (instr.source_is_sp()) ? creg(13) + offset : (const_pc() & ~0b10u) + offset;
+	uint32 address;
+	if constexpr(known.source_is_sp()) {
+		address = creg(13) + offset;
+	} else {
+		address = (const_pc() & ~0b10u) + offset;
+	}
 
 	destination = address;
 
@@ -377,32 +380,35 @@ void ARM7TDMI::THUMB_FMT13(thumb::InstructionFormat13 instr) {
 	m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT14(thumb::InstructionFormat14 instr) {
+	constexpr thumb::InstructionFormat14 known(bits << 6u);
+
 	unsigned n = 0;
 
 	//  POP {Rlist}
-	if(instr.load_from_memory()) {
+	if constexpr(known.load_from_memory()) {
 		for(int8 i = 0; i < 8; ++i) {
 			if(instr.is_register_in_list(i)) {
 				reg(i) = stack_pop32();
 				++n;
 			}
 		}
-		if(instr.store_lr_load_pc()) {
+		if constexpr(known.store_lr_load_pc()) {
 			pc() = stack_pop32() & ~0x1;
 		}
 
 		//  FIXME: Weird timing edge cases
 		m_wait_cycles += 1 /*I*/ + mem_waits_access32(sp() + 0, AccessType::NonSeq) +
 		                 n * mem_waits_access32(sp() + 0, AccessType::Seq);
-		if(instr.store_lr_load_pc()) {
+		if constexpr(known.store_lr_load_pc()) {
 			m_wait_cycles += mem_waits_access32(const_pc(), AccessType::NonSeq) +
 			                 mem_waits_access32(const_pc() + 2, AccessType::Seq);
 		}
 	}
 	//  PUSH {Rlist}
 	else {
-		if(instr.store_lr_load_pc()) {
+		if constexpr(known.store_lr_load_pc()) {
 			stack_push32(lr());
 		}
 		for(int8 i = 8; i >= 0; --i) {
@@ -478,8 +484,11 @@ void ARM7TDMI::THUMB_FMT15(thumb::InstructionFormat15 instr) {
 	}
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT16(thumb::InstructionFormat16 instr) {
-	if(!cspr().evaluate_condition(instr.condition())) {
+	constexpr thumb::InstructionFormat16 known(bits << 6u);
+
+	if(!cspr().evaluate_condition(known.condition())) {
 		m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
 		return;
 	}
@@ -495,7 +504,11 @@ void ARM7TDMI::THUMB_FMT16(thumb::InstructionFormat16 instr) {
 	                 mem_waits_access16(const_pc() + 2, AccessType::Seq);
 }
 
-void ARM7TDMI::THUMB_FMT17(thumb::InstructionFormat17) {
+void ARM7TDMI::THUMB_FMT17(thumb::InstructionFormat17 instr) {
+	if(hle_swi(instr.comment())) {
+		m_wait_cycles += mem_waits_access16(const_pc(), AccessType::Seq);
+		return;
+	}
 	enter_swi();
 }
 
@@ -509,8 +522,11 @@ void ARM7TDMI::THUMB_FMT18(thumb::InstructionFormat18 instr) {
 	                 mem_waits_access16(const_pc() + 2, AccessType::Seq);
 }
 
+template<uint16 bits>
 void ARM7TDMI::THUMB_FMT19(thumb::InstructionFormat19 instr) {
-	if(!instr.low()) {
+	constexpr thumb::InstructionFormat19 known(bits << 6u);
+
+	if constexpr(!known.low()) {
 		auto offset = Bits::sign_extend<23>(static_cast<uint32>(instr.offset()) << 12u);
 		lr() = (const_pc() + offset);
 
@@ -662,3 +678,63 @@ void ARM7TDMI::THUMB_MUL(thumb::InstructionFormat4 instr) {
 	m_wait_cycles += mult_m_cycles(target) /*I*/;
 	target = result;
 }
+
+template<uint16 bits>
+void ARM7TDMI::THUMB_dispatch(uint16 opcode) {
+	using disarmv4t::thumb::InstructionType;
+	constexpr auto type = disarmv4t::thumb::decode(bits << 6u);
+
+	//  Handlers are only instantiated on the bits that select their variant,
+	//  so that opcodes differing in operands alone share the same handler
+	if constexpr(type == InstructionType::FMT1) {
+		THUMB_FMT1<bits & 0x3e0u>(opcode);
+	} else if constexpr(type == InstructionType::FMT2) {
+		THUMB_FMT2<bits & 0x3f8u>(opcode);
+	} else if constexpr(type == InstructionType::FMT3) {
+		THUMB_FMT3<bits & 0x3e0u>(opcode);
+	} else if constexpr(type == InstructionType::FMT4) {
+		THUMB_ALU<bits>(opcode);
+	} else if constexpr(type == InstructionType::FMT5) {
+		THUMB_FMT5<bits>(opcode);
+	} else if constexpr(type == InstructionType::FMT6) {
+		THUMB_FMT6(opcode);
+	} else if constexpr(type == InstructionType::FMT7) {
+		THUMB_FMT7<bits & 0x3f0u>(opcode);
+	} else if constexpr(type == InstructionType::FMT8) {
+		THUMB_FMT8<bits & 0x3f0u>(opcode);
+	} else if constexpr(type == InstructionType::FMT9) {
+		THUMB_FMT9<bits & 0x3e0u>(opcode);
+	} else if constexpr(type == InstructionType::FMT10) {
+		THUMB_FMT10<bits & 0x3e0u>(opcode);
+	} else if constexpr(type == InstructionType::FMT11) {
+		THUMB_FMT11<bits & 0x3e0u>(opcode);
+	} else if constexpr(type == InstructionType::FMT12) {
+		THUMB_FMT12<bits & 0x3e0u>(opcode);
+	} else if constexpr(type == InstructionType::FMT13) {
+		THUMB_FMT13(opcode);
+	} else if constexpr(type == InstructionType::FMT14) {
+		THUMB_FMT14<bits & 0x3e4u>(opcode);
+	} else if constexpr(type == InstructionType::FMT15) {
+		THUMB_FMT15(opcode);
+	} else if constexpr(type == InstructionType::FMT16) {
+		THUMB_FMT16<bits & 0x3fcu>(opcode);
+	} else if constexpr(type == InstructionType::FMT17) {
+		THUMB_FMT17(opcode);
+	} else if constexpr(type == InstructionType::FMT18) {
+		THUMB_FMT18(opcode);
+	} else if constexpr(type == InstructionType::FMT19) {
+		THUMB_FMT19<bits & 0x3e0u>(opcode);
+	} else {
+		//  Undefined encodings also depend on the lower bits of the opcode
+		THUMB_undefined(opcode);
+	}
+}
+
+template<uint16... bits>
+constexpr std::array<ARM7TDMI::ThumbHandler, sizeof...(bits)>
+ARM7TDMI::make_thumb_handlers(std::integer_sequence<uint16, bits...>) {
+	return { &ARM7TDMI::THUMB_dispatch<bits>... };
+}
+
+const std::array<ARM7TDMI::ThumbHandler, 1024> ARM7TDMI::s_thumb_handlers =
+        make_thumb_handlers(std::make_integer_sequence<uint16, 1024>());
@@ -5,21 +5,26 @@
 
 void ARM7TDMI::enter_irq() {
 	const uint32 offset = cspr().state() == INSTR_MODE::ARM ? 4 : 0;
-	m_registers.m_gIRQ[1] = const_pc() - offset;
+	const auto previous = cspr().mode();
 	m_saved_status.m_IRQ = cspr();
 	cspr().set_state(INSTR_MODE::ARM);
 	cspr().set_mode(PRIV_MODE::IRQ);
 	cspr().set(CSPR_REGISTERS::IRQn, true);
+	swap_register_bank(previous);
+	lr() = const_pc() - offset;
 	pc() = 0x18 + 8;
 	m_pc_dirty = false;
 }
 
 void ARM7TDMI::enter_swi() {
-	m_registers.m_gSVC[1] = const_pc() - current_instr_len();
+	const uint32 return_address = const_pc() - current_instr_len();
+	const auto previous = cspr().mode();
 	m_saved_status.m_SVC = cspr();
 	cspr().set_state(INSTR_MODE::ARM);
 	cspr().set_mode(PRIV_MODE::SVC);
 	cspr().set(CSPR_REGISTERS::IRQn, true);
+	swap_register_bank(previous);
+	lr() = return_address;
 	pc() = 0x08;
 
 	m_wait_cycles += mem_waits_access32(const_pc(), AccessType::NonSeq) +
@@ -1,5 +1,6 @@
 #pragma once
 #include <disarmv4t/condition.hpp>
+#include <fmt/format.h>
 #include "Emulator/StdTypes.hpp"
 
 enum class INSTR_MODE {
@@ -38,9 +39,47 @@ enum class CSPR_REGISTERS : unsigned int {
 
 /*
  *  Current Program Status Register
+ *
+ *  The condition flags are evaluated lazily. Flag-setting ALU operations only
+ *  record their result and operands, and NZCV are computed from those the
+ *  first time anything reads the register.
  */
 class CSPR {
-	uint32 data;
+	static constexpr uint32 nz_mask = (uint32)CSPR_REGISTERS::Negative | (uint32)CSPR_REGISTERS::Zero;
+	static constexpr uint32 cv_mask = (uint32)CSPR_REGISTERS::Carry | (uint32)CSPR_REGISTERS::Overflow;
+	static constexpr uint32 flags_mask = nz_mask | cv_mask;
+
+	enum PendingFlags : uint8 {
+		PendingNZ = 1u << 0u,
+		PendingCV = 1u << 1u,
+	};
+
+	mutable uint32 data;
+	mutable uint8 m_pending { 0 };
+	//  Result that N and Z are derived from
+	uint32 m_nz_result { 0 };
+	//  C and V are derived from the addition m_cv_op1 + m_cv_op2 + m_cv_carry
+	uint32 m_cv_op1 { 0 };
+	uint32 m_cv_op2 { 0 };
+	bool m_cv_carry { false };
+
+	inline void materialise() const {
+		if(!m_pending) [[likely]] {
+			return;
+		}
+		if(m_pending & PendingNZ) {
+			data = (data & ~nz_mask) | (m_nz_result & (uint32)CSPR_REGISTERS::Negative) |
+			       (m_nz_result == 0 ? (uint32)CSPR_REGISTERS::Zero : 0u);
+		}
+		if(m_pending & PendingCV) {
+			const uint32 result = m_cv_op1 + m_cv_op2 + (m_cv_carry ? 1u : 0u);
+			const bool carry = m_cv_carry ? result <= m_cv_op1 : result < m_cv_op1;
+			const bool overflow = ((m_cv_op1 ^ result) & (m_cv_op2 ^ result)) >> 31u;
+			data = (data & ~cv_mask) | (carry ? (uint32)CSPR_REGISTERS::Carry : 0u) |
+			       (overflow ? (uint32)CSPR_REGISTERS::Overflow : 0u);
+		}
+		m_pending = 0;
+	}
 
 	static inline bool verify_mode(uint32 data) {
 		data &= 0b11111;
@@ -59,6 +98,7 @@ public:
 	CSPR() = default;
 
 	void set_raw(uint32 v) {
+		materialise();
 		if(mode() != PRIV_MODE::USR && !verify_mode(v)) {
 			fmt::print("PSR/ Tried writing invalid mode bits! {:08x}\n", v);
 			v = (v & ~0x1f) | (uint32)mode();
@@ -71,15 +111,51 @@ public:
 		}
 	}
 
-	uint32 raw() const { return data; }
+	uint32 raw() const {
+		materialise();
+		return data;
+	}
+
+	inline bool is_set(CSPR_REGISTERS mask) const {
+		if((uint32)mask & flags_mask) {
+			materialise();
+		}
+		return (data & (uint32)mask);
+	}
+
+	inline bool is_clear(CSPR_REGISTERS mask) const { return !is_set(mask); }
 
-	inline bool is_set(CSPR_REGISTERS mask) const { return (data & (uint32)mask); }
+	void set(CSPR_REGISTERS reg, bool v) {
+		if((uint32)reg & flags_mask) {
+			materialise();
+		}
+		data = (data & (~(uint32)reg)) | (v ? (uint32)reg : 0);
+	}
 
-	inline bool is_clear(CSPR_REGISTERS mask) const { return !(data & (uint32)mask); }
+	/*
+	 *  Defers N and Z to be computed from the given result, C and V are left
+	 *  untouched.
+	 */
+	inline void defer_nz(uint32 result) {
+		m_nz_result = result;
+		m_pending |= PendingNZ;
+	}
 
-	void set(CSPR_REGISTERS reg, bool v) { data = (data & (~(uint32)reg)) | (v ? (uint32)reg : 0); }
+	/*
+	 *  Defers all condition flags to be computed from op1 + op2 + carry.
+	 *  Subtractions are deferred as op1 + ~op2 + carry, with the carry
+	 *  being the inverted borrow.
+	 */
+	inline void defer_nzcv(uint32 op1, uint32 op2, bool carry) {
+		m_nz_result = op1 + op2 + (carry ? 1u : 0u);
+		m_cv_op1 = op1;
+		m_cv_op2 = op2;
+		m_cv_carry = carry;
+		m_pending = PendingNZ | PendingCV;
+	}
 
 	void set_flags(uint32 flags, bool F, bool S, bool X, bool C) {
+		materialise();
 		if(F) {
 			data &= ~0xff000000;
 			data |= flags & 0xff000000;
@@ -131,6 +207,10 @@ public:
 	void set_mode(PRIV_MODE mode) { data = (data & ~0b11111u) | ((uint32)mode & 0b11111u); }
 
 	bool evaluate_condition(disarmv4t::InstructionCondition condition) const {
+		if(condition == disarmv4t::InstructionCondition::AL) [[likely]] {
+			return true;
+		}
+		materialise();
 		switch(condition) {
 			case disarmv4t::InstructionCondition::EQ: return is_set(CSPR_REGISTERS::Zero);
 			case disarmv4t::InstructionCondition::NE: return is_clear(CSPR_REGISTERS::Zero);
@@ -3,55 +3,124 @@
 #include "Bus/IO/IOContainer.hpp"
 #include "CPU/ARM7TDMI.hpp"
 #include "Emulator/GaBber.hpp"
+#include "Emulator/Scheduler.hpp"
 
-void ARM7TDMI::timers_cycle_all(size_t n) {
-	timers_cycle_n(io().timer0, n);
-	timers_cycle_n(io().timer1, n);
-	timers_cycle_n(io().timer2, n);
-	timers_cycle_n(io().timer3, n);
+template<unsigned int x>
+uint16 TimerReload<x>::on_read() {
+	return this->cpu().template on_timer_counter_read<x>();
 }
 
-template<unsigned int timer_num>
-void ARM7TDMI::timers_cycle_n(Timer<timer_num>& timer, size_t n) {
-	if(!timer.m_ctl->timer_enable) {
-		timer.m_previous_cycle_was_running = false;
-		return;
+template<unsigned int x>
+void TimerCtl<x>::on_write(uint16 val) {
+	this->cpu().template on_timer_control_write<x>(val & writeable_mask);
+}
+
+template<unsigned timer_num>
+static constexpr EventType overflow_event() {
+	return static_cast<EventType>(static_cast<unsigned>(EventType::Timer0Overflow) + timer_num);
+}
+
+/*
+ *  Timers which are not counting up are only updated when they overflow,
+ *  which is a scheduled event. In between, the counter is calculated from the
+ *  time elapsed since the last overflow or control write. Like all I/O, the
+ *  timers see the time at the start of the current CPU step.
+ */
+template<unsigned timer_num>
+uint16 ARM7TDMI::timers_counter(Timer<timer_num> const& timer) const {
+	const uint16 latched = *timer.m_reload_and_current;
+	if(!timer.m_ctl->timer_enable || timer.m_ctl->count_up) {
+		return latched;
 	}
-	if(timer.m_ctl->count_up) {
+
+	const uint64 cycles_per_tick = Timer<timer_num>::cycle_count_from_prescaler(timer.m_ctl->prescaler);
+	return latched + (scheduler().now() - timer.m_start) / cycles_per_tick;
+}
+
+template<unsigned timer_num>
+void ARM7TDMI::timers_schedule_overflow(Timer<timer_num> const& timer) {
+	if(!timer.m_ctl->timer_enable || timer.m_ctl->count_up) {
+		//  Count-up timers can only overflow together with the previous timer
+		scheduler().cancel(overflow_event<timer_num>());
 		return;
 	}
 
-	//  On changing start bit 0 -> 1, copy the reload value to the counter
-	if(!timer.m_previous_cycle_was_running) {
-		*timer.m_reload_and_current = timer.m_reload_and_current.reload_value();
-		timer.m_previous_cycle_was_running = true;
-	}
+	const uint64 cycles_per_tick = Timer<timer_num>::cycle_count_from_prescaler(timer.m_ctl->prescaler);
+	const uint64 ticks = 0x10000 - *timer.m_reload_and_current;
+	scheduler().schedule_at(overflow_event<timer_num>(), timer.m_start + ticks * cycles_per_tick);
+}
 
-	timer.m_timer_cycles += n;
-	auto cycles_per_tick = Timer<timer_num>::cycle_count_from_prescaler(timer.m_ctl->prescaler);
-	while(timer.m_timer_cycles >= cycles_per_tick) {
-		timer.m_timer_cycles -= cycles_per_tick;
-		timers_increment(timer);
+template<unsigned timer_num>
+void ARM7TDMI::timers_overflow(Timer<timer_num>& timer, uint64 timestamp) {
+	apu().on_timer_overflow(timer_num);
+
+	*timer.m_reload_and_current = timer.m_reload_and_current.reload_value();
+	if(timer.m_ctl->irq_enable)
+		raise_irq(Timer<timer_num>::irq_for_timer());
+
+	if constexpr(timer_num != 3) {
+		Timer<timer_num + 1>& other_timer = io().template timer_for_num<timer_num + 1>();
+		if(other_timer.m_ctl->count_up)
+			timers_increment<timer_num + 1>(other_timer, timestamp);
 	}
 }
 
-template<unsigned int timer_num>
-void ARM7TDMI::timers_increment(Timer<timer_num>& timer) {
-	//  Timer overflow
+template<unsigned timer_num>
+void ARM7TDMI::timers_increment(Timer<timer_num>& timer, uint64 timestamp) {
 	if(*timer.m_reload_and_current == 0xFFFF) {
-		apu().on_timer_overflow(timer_num);
+		timers_overflow(timer, timestamp);
+	} else {
+		(*timer.m_reload_and_current)++;
+	}
+}
 
-		*timer.m_reload_and_current = timer.m_reload_and_current.reload_value();
-		if(timer.m_ctl->irq_enable)
-			raise_irq(Timer<timer_num>::irq_for_timer());
+template<unsigned timer_num>
+uint16 ARM7TDMI::on_timer_counter_read() {
+	m_timer_polled = true;
+	return timers_counter(io().template timer_for_num<timer_num>());
+}
 
-		if constexpr(timer_num != 3) {
-			Timer<timer_num + 1>& other_timer = io().template timer_for_num<timer_num + 1>();
-			if(other_timer.m_ctl->count_up)
-				timers_increment<timer_num + 1>(other_timer);
-		}
+template<unsigned timer_num>
+void ARM7TDMI::on_timer_control_write(uint16 value) {
+	auto& timer = io().template timer_for_num<timer_num>();
+	const uint64 now = scheduler().now();
+	const bool was_running = timer.m_ctl->timer_enable;
 
-	} else {
-		(*timer.m_reload_and_current)++;
+	//  Latch the counter on the last prescaler tick before the write
+	if(was_running && !timer.m_ctl->count_up) {
+		const uint64 cycles_per_tick = Timer<timer_num>::cycle_count_from_prescaler(timer.m_ctl->prescaler);
+		*timer.m_reload_and_current = timers_counter(timer);
+		timer.m_start = now - (now - timer.m_start) % cycles_per_tick;
+	} else if(was_running) {
+		timer.m_start = now;
 	}
+
+	*timer.m_ctl = value;
+	//  On changing start bit 0 -> 1, copy the reload value to the counter
+	if(!was_running && timer.m_ctl->timer_enable) {
+		*timer.m_reload_and_current = timer.m_reload_and_current.reload_value();
+		timer.m_start = now;
+	}
+	timers_schedule_overflow(timer);
 }
+
+template<unsigned timer_num>
+void ARM7TDMI::on_timer_overflow(uint64 timestamp) {
+	auto& timer = io().template timer_for_num<timer_num>();
+	timers_overflow(timer, timestamp);
+	timer.m_start = timestamp;
+	timers_schedule_overflow(timer);
+}
+
+template uint16 TimerReload<0>::on_read();
+template uint16 TimerReload<1>::on_read();
+template uint16 TimerReload<2>::on_read();
+template uint16 TimerReload<3>::on_read();
+template void TimerCtl<0>::on_write(uint16);
+template void TimerCtl<1>::on_write(uint16);
+template void TimerCtl<2>::on_write(uint16);
+template void TimerCtl<3>::on_write(uint16);
+template void ARM7TDMI::on_timer_overflow<0>(uint64);
+template void ARM7TDMI::on_timer_overflow<1>(uint64);
+template void ARM7TDMI::on_timer_overflow<2>(uint64);
+template void ARM7TDMI::on_timer_overflow<3>(uint64);
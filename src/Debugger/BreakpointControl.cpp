@@ -36,7 +36,7 @@ void BreakpointControl::draw_window() {
 	if(ImGui::Button("Add", ImVec2(-FLT_MIN, 0))) {
 		//  FIXME:
 		m_break.size = 1;
-		m_emu.debugger().m_breakpoints.push_back(m_break);
+		m_emu.debugger().add_breakpoint(m_break);
 	}
 	if(!valid) {
 		ImGui::PopItemFlag();
@@ -55,13 +55,14 @@ void BreakpointControl::draw_window() {
 			            (breakpoint.type & BreakExec) ? 'X' : '-');
 			ImGui::SameLine();
 
-			ImGui::PushID(n++);
+			ImGui::PushID(n);
 			if(ImGui::Button("Remove", ImVec2(-FLT_MIN, 0.0f))) {
-				m_emu.debugger().m_breakpoints.erase(m_emu.debugger().m_breakpoints.begin() + n);
+				m_emu.debugger().remove_breakpoint(n);
 				ImGui::PopID();
 				break;
 			}
 			ImGui::PopID();
+			++n;
 		}
 
 		ImGui::EndChild();
@@ -1,5 +1,7 @@
 #include "Debugger/Debugger.hpp"
+#include <algorithm>
 #include <fmt/format.h>
+#include "CPU/ARM7TDMI.hpp"
 #include "Emulator/GaBber.hpp"
 
 void Debugger::draw_debugger_contents() {
@@ -29,6 +31,33 @@ bool Debugger::match_breakpoint(Breakpoint const& breakpoint, MemoryEvent event)
 	return !not_overlapping && matched_flags;
 }
 
+void Debugger::add_breakpoint(Breakpoint breakpoint) {
+	m_breakpoints.push_back(breakpoint);
+	rebuild_breakpoint_pages();
+}
+
+void Debugger::remove_breakpoint(size_t index) {
+	if(index >= m_breakpoints.size()) {
+		return;
+	}
+	m_breakpoints.erase(m_breakpoints.begin() + index);
+	rebuild_breakpoint_pages();
+}
+
+void Debugger::rebuild_breakpoint_pages() {
+	m_breakpoint_pages.fill(0);
+	for(auto const& breakpoint : m_breakpoints) {
+		//  match_breakpoint also accepts accesses that merely touch either end
+		//  of the breakpoint, so widen the range by the largest access size
+		const uint64 first = breakpoint.start >= 4 ? breakpoint.start - 4 : 0;
+		const uint64 last = std::min<uint64>(static_cast<uint64>(breakpoint.start) + breakpoint.size, 0xFFFFFFFF);
+		for(uint64 page = first >> breakpoint_page_bits; page <= (last >> breakpoint_page_bits); ++page) {
+			m_breakpoint_pages[page] |= breakpoint.type;
+		}
+	}
+	cpu().invalidate_fetch_window();
+}
+
 void Debugger::on_memory_access(uint32 address, uint32 val, bool write) {
 	auto it = std::find_if(m_breakpoints.begin(), m_breakpoints.end(), [address, val, write](auto& v) {
 		return match_breakpoint(v, { address, val, 4, write ? BreakWrite : BreakRead });
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <functional>
 #include <imgui.h>
 #include <string>
@@ -20,6 +21,15 @@ class Debugger : Module {
 
 	static bool match_breakpoint(Breakpoint const& breakpoint, MemoryEvent event);
 	std::vector<Breakpoint> m_breakpoints;
+
+	/*
+	 *  Breakpoint types armed within each 64KiB page of the address space.
+	 *  Accesses to pages without any armed breakpoints skip the debugger hooks.
+	 */
+	static constexpr const unsigned breakpoint_page_bits = 16;
+	std::array<uint8, (1u << (32 - breakpoint_page_bits))> m_breakpoint_pages {};
+	void rebuild_breakpoint_pages();
+
 	bool m_break_on_undefined { false };
 	bool m_debug_mode { false };
 public:
@@ -30,6 +40,14 @@ public:
 	bool is_debug_mode() const { return m_debug_mode; }
 	void set_debug_mode(bool v) { m_debug_mode = v; }
 
+	bool is_armed(uint32 address, BreakpointType type) const {
+		return (m_breakpoint_pages[address >> breakpoint_page_bits] & type) != 0;
+	}
+
+	bool has_breakpoints() const { return !m_breakpoints.empty(); }
+	void add_breakpoint(Breakpoint);
+	void remove_breakpoint(size_t index);
+
 	void on_memory_access(uint32 address, uint32 val, bool write);
 	void on_memory_access(uint32 address, uint16 val, bool write);
 	void on_memory_access(uint32 address, uint8 val, bool write);
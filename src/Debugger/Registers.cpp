@@ -1,3 +1,4 @@
+#include <utility>
 #include "CPU/ARM7TDMI.hpp"
 #include "Debugger/WindowDefinitions.hpp"
 #include "Emulator/GaBber.hpp"
@@ -44,4 +45,17 @@ void GPRs::draw_window() {
 	}
 	ImGui::Text("Mode: %s", cpu.cspr().mode_str());
 	ImGui::Text("CPSR: %08x", cpu.cspr().raw());
+
+	ImGui::Separator();
+	ImGui::Text("Banked registers:");
+	static constexpr std::pair<PRIV_MODE, const char*> s_modes[] {
+		{ PRIV_MODE::USR, "USR" }, { PRIV_MODE::FIQ, "FIQ" }, { PRIV_MODE::SVC, "SVC" },
+		{ PRIV_MODE::ABT, "ABT" }, { PRIV_MODE::IRQ, "IRQ" }, { PRIV_MODE::UND, "UND" },
+	};
+	for(auto const& [mode, name] : s_modes) {
+		ImGui::Text("%s: r13: %08x  r14: %08x", name, cpu.banked_reg(mode, 13), cpu.banked_reg(mode, 14));
+	}
+	ImGui::Text("FIQ: r08: %08x  r09: %08x  r10: %08x  r11: %08x  r12: %08x", cpu.banked_reg(PRIV_MODE::FIQ, 8),
+	            cpu.banked_reg(PRIV_MODE::FIQ, 9), cpu.banked_reg(PRIV_MODE::FIQ, 10),
+	            cpu.banked_reg(PRIV_MODE::FIQ, 11), cpu.banked_reg(PRIV_MODE::FIQ, 12));
 }
\ No newline at end of file
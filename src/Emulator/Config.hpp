@@ -1,4 +1,5 @@
 #pragma once
+#include "Emulator/StdTypes.hpp"
 
 struct Config {
 	unsigned volume { 60 };
@@ -8,4 +9,13 @@ struct Config {
 	bool apu_ch3_enabled { true };
 	bool apu_ch4_enabled { true };
 	bool apu_fifo_enabled { true };
+	bool cpu_block_cache { false };
+	bool cpu_block_cache_verify { false };
+	bool cpu_dynarec { false };
+	bool cpu_dynarec_lockstep { false };
+	bool cpu_idle_loop_skip { true };
+	bool ppu_threaded { false };
+	bool bios_hle { false };
+	//  Bitmask of the SWI numbers handled natively when BIOS HLE is enabled
+	uint64 bios_hle_swis { ~0ull };
 };
\ No newline at end of file
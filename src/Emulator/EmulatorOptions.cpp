@@ -4,4 +4,13 @@
 
 void EmulatorOptions::draw() {
 	ImGui::InputScalar("Framerate", ImGuiDataType_U32, &config().target_framerate);
+	ImGui::Checkbox("BIOS HLE", &config().bios_hle);
+	ImGui::InputScalar("HLE SWI mask", ImGuiDataType_U64, &config().bios_hle_swis, nullptr, nullptr, "%016llx",
+	                   ImGuiInputTextFlags_CharsHexadecimal);
+	ImGui::Checkbox("Skip idle loops", &config().cpu_idle_loop_skip);
+	ImGui::Checkbox("Block cache", &config().cpu_block_cache);
+	ImGui::Checkbox("Verify block cache", &config().cpu_block_cache_verify);
+	ImGui::Checkbox("Dynarec", &config().cpu_dynarec);
+	ImGui::Checkbox("Dynarec lockstep", &config().cpu_dynarec_lockstep);
+	ImGui::Checkbox("Threaded PPU", &config().ppu_threaded);
 }
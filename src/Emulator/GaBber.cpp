@@ -1,4 +1,5 @@
 #include "GaBber.hpp"
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -11,6 +12,7 @@
 #include "CPU/ARM7TDMI.hpp"
 #include "Debugger/Debugger.hpp"
 #include "Emulator/Renderer.hpp"
+#include "Emulator/Scheduler.hpp"
 #include "PPU/PPU.hpp"
 
 GaBber::GaBber() {
@@ -21,11 +23,11 @@ GaBber::GaBber() {
 	m_ppu = std::make_shared<PPU>(*this);
 	m_sound = std::make_shared<APU>(*this);
 	m_renderer = std::make_shared<Renderer>(*this);
+	m_scheduler = std::make_shared<Scheduler>(*this);
 }
 
 std::optional<std::vector<uint8>> load_from_file(const std::string& path) {
 	std::ifstream file;
-	std::vector<char> temp;
 	file.open(path, std::ios::binary);
 	if(!file.good()) {
 		return {};
@@ -34,12 +36,11 @@ std::optional<std::vector<uint8>> load_from_file(const std::string& path) {
 	file.seekg(0, file.end);
 	size_t fileSize = file.tellg();
 	file.seekg(0, file.beg);
-	temp.resize(fileSize);
-	file.read(&temp[0], fileSize);
+	std::vector<uint8> contents(fileSize);
+	file.read(reinterpret_cast<char*>(contents.data()), fileSize);
 	file.close();
-	std::vector<uint8> rom(temp.begin(), temp.end());
 
-	return { rom };
+	return { std::move(contents) };
 }
 
 bool GaBber::parse_args(int argc, char** argv) {
@@ -50,6 +51,12 @@ bool GaBber::parse_args(int argc, char** argv) {
 		fmt::print("\t--bios <path>\t\tUse the specified file as the BIOS\n");
 		fmt::print("\t--save <path>\t\tUse the specified save file\n");
 		fmt::print("\t--test\t\tRun emulator tests\n");
+		fmt::print("\t--block-cache\t\tExecute code through the cache of pre-decoded instruction blocks\n");
+		fmt::print("\t--bios-hle\t\tRun hot BIOS calls natively, allows booting without a BIOS\n");
+		fmt::print("\t--bios-hle-swis <mask>\t\tHex mask of the SWI numbers to run natively\n");
+		fmt::print("\t--dynarec\t\tRecompile guest code to x86-64 host code\n");
+		fmt::print("\t--dynarec-lockstep\t\tCheck recompiled code against the interpreter\n");
+		fmt::print("\t--threaded-ppu\t\tDraw scanlines on a separate thread\n");
 		return false;
 	}
 
@@ -75,6 +82,32 @@ bool GaBber::parse_args(int argc, char** argv) {
 		if(*it == "--debug") {
 			m_debugger->set_debug_mode(true);
 			skip(2);
+		} else if(*it == "--block-cache") {
+			m_config.cpu_block_cache = true;
+			skip(1);
+		} else if(*it == "--bios-hle") {
+			m_config.bios_hle = true;
+			skip(1);
+		} else if(*it == "--bios-hle-swis") {
+			auto mask = peek();
+			if(mask.has_value()) {
+				m_config.bios_hle = true;
+				m_config.bios_hle_swis = std::strtoull(mask->c_str(), nullptr, 16);
+				skip(2);
+			} else {
+				fmt::print("Missing mask for argument '--bios-hle-swis'\n");
+				return false;
+			}
+		} else if(*it == "--dynarec") {
+			m_config.cpu_dynarec = true;
+			skip(1);
+		} else if(*it == "--dynarec-lockstep") {
+			m_config.cpu_dynarec = true;
+			m_config.cpu_dynarec_lockstep = true;
+			skip(1);
+		} else if(*it == "--threaded-ppu") {
+			m_config.ppu_threaded = true;
+			skip(1);
 		} else if(*it == "--bios") {
 			auto name = peek();
 			if(name.has_value()) {
@@ -115,16 +148,34 @@ bool GaBber::parse_args(int argc, char** argv) {
 
 int GaBber::start() {
 	auto bios_image = load_from_file(m_bios_filename);
-	if(!bios_image.has_value()) {
+	if(bios_image.has_value()) {
+		m_mem->bios.from_vec(*bios_image);
+	} else if(m_config.bios_hle) {
+		fmt::print("Failed loading BIOS from file '{}', booting with BIOS HLE\n", m_bios_filename);
+		m_mem->bios.load_hle_stub();
+		m_bios_hle_boot = true;
+
+		//  Without a BIOS image, every SWI the game makes has to be handled natively
+		const uint64 supported = ARM7TDMI::hle_supported_swis();
+		if((m_config.bios_hle_swis & supported) != supported) {
+			fmt::print("HLE SWI mask {:016x} excludes calls required without a BIOS image ({:016x})\n",
+			           m_config.bios_hle_swis, supported);
+			return 1;
+		}
+	} else {
 		fmt::print("Failed loading BIOS from file '{}'\n", m_bios_filename);
 		return 1;
 	}
-	m_mem->bios.from_vec(*bios_image);
 
-	auto rom = load_from_file(m_rom_filename);
-	if(!rom.has_value()) {
-		fmt::print("Failed loading ROM from file '{}'\n", m_rom_filename);
-		return 1;
+	//  Map the ROM straight from the file, and only fall back to reading it
+	//  into memory if that does not work
+	if(!m_mem->pak.rom.from_file(m_rom_filename)) {
+		auto rom = load_from_file(m_rom_filename);
+		if(!rom.has_value()) {
+			fmt::print("Failed loading ROM from file '{}'\n", m_rom_filename);
+			return 1;
+		}
+		m_mem->pak.rom.from_vec(std::move(*rom));
 	}
 
 	std::vector<uint8> save = {};
@@ -135,7 +186,7 @@ int GaBber::start() {
 		fmt::print("Failed loading save file from file '{}'\n", m_save_filename);
 	}
 
-	m_mem->pak.load_pak(std::move(*rom), std::move(save));
+	m_mem->pak.load_pak(std::move(save), m_rom_filename);
 
 	emulator_reset();
 
@@ -172,10 +223,7 @@ void GaBber::emulator_loop() {
 void GaBber::emulator_next_state() {
 	const unsigned cycles = m_cpu->run_next_instruction();
 	assert(cycles > 0 && "Trying to emulate zero cycles!");
-	for(unsigned i = 0; i < cycles; ++i) {
-		m_ppu->cycle();
-		m_sound->cycle();
-	}
+	m_scheduler->advance(cycles);
 
 	m_cycle_samples[m_current_sample++] = cycles;
 	if(mem().io.haltcnt.m_halt) {
@@ -205,6 +253,10 @@ void GaBber::enter_debug_mode() {
 void GaBber::emulator_reset() {
 	m_cpu->reset();
 	m_mmu->reload();
+	m_scheduler->reset();
+	if(m_bios_hle_boot) {
+		m_cpu->hle_boot();
+	}
 }
 
 void GaBber::emulator_close() {
@@ -11,6 +11,7 @@ class TestHarness;
 class MemoryLayout;
 class APU;
 class Renderer;
+class Scheduler;
 
 class GaBber {
 	friend class Module;
@@ -27,8 +28,10 @@ class GaBber {
 	std::shared_ptr<PPU> m_ppu;
 	std::shared_ptr<APU> m_sound;
 	std::shared_ptr<Renderer> m_renderer;
+	std::shared_ptr<Scheduler> m_scheduler;
 	bool m_running { true };
 	bool m_do_step { false };
+	bool m_bios_hle_boot { false };
 
 	bool m_closed { false };
 	unsigned m_current_sample { 0 };
@@ -52,6 +55,7 @@ public:
 	APU& sound() { return *m_sound; }
 	Config& config() { return m_config; }
 	Renderer& renderer() { return *m_renderer; }
+	Scheduler& scheduler() { return *m_scheduler; }
 
 	void toggle_debug_mode();
 	void enter_debug_mode();
@@ -33,6 +33,10 @@ BusInterface& Module::bus() const {
 	return m_emu.mmu();
 }
 
+Scheduler& Module::scheduler() const {
+	return m_emu.scheduler();
+}
+
 Config& Module::config() const {
 	return m_emu.config();
 }
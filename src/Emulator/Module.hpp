@@ -7,6 +7,7 @@ class ARM7TDMI;
 class APU;
 class PPU;
 class BusInterface;
+class Scheduler;
 struct Config;
 struct MemoryLayout;
 struct IOContainer;
@@ -25,4 +26,5 @@ public:
 	APU& apu() const;
 	PPU& ppu() const;
 	BusInterface& bus() const;
+	Scheduler& scheduler() const;
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "Emulator/Scheduler.hpp"
+#include "APU/APU.hpp"
+#include "CPU/ARM7TDMI.hpp"
+#include "PPU/PPU.hpp"
+
+Scheduler::Scheduler(GaBber& emu)
+    : Module(emu) {
+	m_deadlines.fill(never);
+}
+
+void Scheduler::reset() {
+	m_now = 0;
+	m_deadlines.fill(never);
+	m_next_deadline = never;
+
+	ppu().schedule_events(m_now);
+	apu().schedule_events(m_now);
+}
+
+void Scheduler::schedule_at(EventType type, uint64 timestamp) {
+	m_deadlines[static_cast<size_t>(type)] = timestamp;
+	if(timestamp < m_next_deadline) {
+		m_next_deadline = timestamp;
+	}
+}
+
+void Scheduler::cancel(EventType type) {
+	m_deadlines[static_cast<size_t>(type)] = never;
+	update_next_deadline();
+}
+
+void Scheduler::update_next_deadline() {
+	m_next_deadline = never;
+	for(auto deadline : m_deadlines) {
+		if(deadline < m_next_deadline) {
+			m_next_deadline = deadline;
+		}
+	}
+}
+
+void Scheduler::run_due_events() {
+	while(m_now >= m_next_deadline) {
+		//  Lowest deadline first, ties go to the event type listed first
+		size_t next = 0;
+		for(size_t i = 1; i < m_deadlines.size(); ++i) {
+			if(m_deadlines[i] < m_deadlines[next]) {
+				next = i;
+			}
+		}
+
+		const uint64 timestamp = m_deadlines[next];
+		m_deadlines[next] = never;
+		dispatch(static_cast<EventType>(next), timestamp);
+		update_next_deadline();
+	}
+}
+
+void Scheduler::dispatch(EventType type, uint64 timestamp) {
+	switch(type) {
+		case EventType::Timer0Overflow: cpu().on_timer_overflow<0>(timestamp); break;
+		case EventType::Timer1Overflow: cpu().on_timer_overflow<1>(timestamp); break;
+		case EventType::Timer2Overflow: cpu().on_timer_overflow<2>(timestamp); break;
+		case EventType::Timer3Overflow: cpu().on_timer_overflow<3>(timestamp); break;
+		case EventType::PPUHBlank: ppu().on_hblank(); break;
+		case EventType::PPUScanline: ppu().on_scanline_end(timestamp); break;
+		case EventType::APUSample: apu().on_sample(timestamp); break;
+		default: ASSERT_NOT_REACHED();
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <array>
+#include <limits>
+#include "Emulator/Module.hpp"
+#include "Emulator/StdTypes.hpp"
+
+/*
+ *  Types of scheduled events. When several events are due at the same
+ *  timestamp, they are dispatched in the order listed here.
+ */
+enum class EventType {
+	Timer0Overflow = 0,
+	Timer1Overflow,
+	Timer2Overflow,
+	Timer3Overflow,
+	PPUHBlank,
+	PPUScanline,
+	APUSample,
+	_Count
+};
+
+/*
+ *  Timestamped events keyed on the global cycle count. Every event type has at
+ *  most one pending deadline. After the CPU has run for a number of cycles, all
+ *  events that became due are dispatched in deadline order, and each handler
+ *  schedules its next occurrence relative to the deadline it was dispatched at.
+ */
+class Scheduler : Module {
+	static constexpr uint64 never = std::numeric_limits<uint64>::max();
+
+	std::array<uint64, static_cast<size_t>(EventType::_Count)> m_deadlines;
+	uint64 m_now { 0 };
+	uint64 m_next_deadline { never };
+
+	void update_next_deadline();
+	void dispatch(EventType, uint64 timestamp);
+	void run_due_events();
+public:
+	Scheduler(GaBber&);
+
+	uint64 now() const { return m_now; }
+	uint64 next_deadline() const { return m_next_deadline; }
+
+	void reset();
+	void schedule_at(EventType, uint64 timestamp);
+	void cancel(EventType);
+
+	void advance(unsigned cycles) {
+		m_now += cycles;
+		if(m_now >= m_next_deadline) {
+			run_due_events();
+		}
+	}
+};
@@ -1,80 +1,68 @@
 #include "PPU/BG.hpp"
-#include "Bus/Common/MemoryLayout.hpp"
 #include "PPU/PPU.hpp"
 
-template<unsigned n>
-constexpr BG<n>& Backgrounds::current_bg() {
-	static_assert(n < 4, "Invalid BG number");
-	if constexpr(n == 0)
-		return m_ppu.io().bg0;
-	else if constexpr(n == 1)
-		return m_ppu.io().bg1;
-	else if constexpr(n == 2)
-		return m_ppu.io().bg2;
-	else
-		return m_ppu.io().bg3;
-}
-
 template<unsigned int n>
 void Backgrounds::draw_textmode() {
-	BG<n> const& bg = current_bg<n>();
+	auto const& bg = m_ppu.m_line.bg[n];
 	if(!bg_enabled<n>())
 		return;
 
-	const auto get_bg_tile_dot = [this](uint32 base, uint16 tile, uint8 ly_in_tile, uint8 dot_in_tile,
-	                                    bool depth_flag) -> uint8 {
-		const unsigned d = depth_flag ? 1 : 2;
-		const unsigned offset_to_tile = tile * (64 / d);
-		const unsigned offset_to_dot = ly_in_tile * (8 / d) + (dot_in_tile / d);
-
-		uint8 byte = m_ppu.mem().vram.readT<uint8>(base + offset_to_tile + offset_to_dot);
-		if(!depth_flag) {
-			const bool is_right_pixel = (dot_in_tile % 2) != 0;
-			if(is_right_pixel)
-				byte >>= 4u;
-			byte &= 0x0Fu;
-		}
-
-		return byte;
-	};
-
-	//	assert(bg.m_control->screen_size == 0);
-	//	assert(bg.m_control->mosaic == 0);
-
-	const uint32 screen_base = bg.m_control->base_screen_block * 2 * kB;
-	const uint32 tile_base = bg.m_control->base_tile_block * 16 * kB;
-	const uint8 priority = bg.m_control->priority;
-	const bool depth = bg.m_control->palette_flag;
-	const unsigned vscreen_width = (bg.m_control->screen_size & 1u) ? 512u : 256u;
-	const unsigned vscreen_height = (bg.m_control->screen_size & 2u) ? 512u : 256u;
-	const unsigned vscreen_screensx = vscreen_width / 256u;
-	const unsigned vscreen_screensy = vscreen_height / 256u;
-
-	const auto scx = *bg.m_xoffset;
-	const auto scy = *bg.m_yoffset;
-	const auto ly = (scy + m_ppu.vcount()) % vscreen_height;
-	const unsigned vscreen_y = (ly / 256u) % vscreen_screensy;
-
-	for(unsigned i = scx; i < scx + 240u; ++i) {
-		const unsigned x = i % vscreen_width;
-		const unsigned vscreen_x = (x / 256u) % vscreen_screensx;
-
-		const unsigned which_vscreen = vscreen_screensx * vscreen_y + vscreen_x;
+	//	assert(bg.control.screen_size == 0);
+	//	assert(bg.control.mosaic == 0);
+
+	const uint32 screen_base = bg.control.base_screen_block * 2 * kB;
+	const uint32 tile_base = bg.control.base_tile_block * 16 * kB;
+	const uint8 priority = bg.control.priority;
+	const bool depth = bg.control.palette_flag;
+	//  Virtual screens are made of one or two 256x256 screens in each direction
+	const bool wide = bg.control.screen_size & 1u;
+	const bool tall = bg.control.screen_size & 2u;
+	const unsigned vscreen_width_mask = wide ? 511u : 255u;
+	const unsigned vscreen_height_mask = tall ? 511u : 255u;
+
+	const auto scx = bg.xoffset;
+	const auto scy = bg.yoffset;
+	const unsigned ly = (scy + m_ppu.m_line.vcount) & vscreen_height_mask;
+	const unsigned vscreen_y = ly >> 8u;
+	const unsigned tile_line = (ly & 7u);
+
+	auto& vram = *m_ppu.m_video.vram;
+
+	//  The line is drawn one tile at a time, starting with the tile that
+	//  contains the leftmost dot, which may be partially scrolled off screen
+	const unsigned first_x = scx & vscreen_width_mask;
+	for(int screen_x = -static_cast<int>(first_x & 7u); screen_x < 240; screen_x += 8) {
+		const unsigned x = (first_x + screen_x) & vscreen_width_mask;
+		const unsigned which_vscreen = (wide ? 2 : 1) * vscreen_y + (x >> 8u);
 		const uint32 vscreen_base = screen_base + which_vscreen * 0x800;
 
 		const TextScreenData text_data =
-		        m_ppu.mem().vram.readT<TextScreenData>(PPU::bg_text_data_offset(vscreen_base, ly % 256u, x % 256u));
+		        vram.readT<TextScreenData>(PPU::bg_text_data_offset(vscreen_base, ly & 255u, x & 255u));
 		const bool xflip = text_data.m_struct.horizontal_flip;
 		const bool yflip = text_data.m_struct.vertical_flip;
 		const uint16 tile = text_data.m_struct.tile_number;
-		const uint16 palette = text_data.m_struct.palette_number;
-
-		const uint8 tile_dot = xflip ? (7 - (x % 8)) : (x % 8);
-		const uint8 tile_line = yflip ? (7 - (ly % 8)) : (ly % 8);
-		const uint8 dot_color = get_bg_tile_dot(tile_base, tile, tile_line, tile_dot, depth);
+		const uint8 row = yflip ? (7 - tile_line) : tile_line;
+
+		//  The whole row of the tile, in screen order
+		uint8 dots_8bpp[8];
+		uint8 const* dots = dots_8bpp;
+		if(depth) {
+			const uint64 data = vram.readT<uint64>(tile_base + tile * 64 + row * 8);
+			for(unsigned i = 0; i < 8; ++i) {
+				dots_8bpp[xflip ? 7 - i : i] = (data >> (i * 8u)) & 0xFFu;
+			}
+		} else {
+			dots = m_ppu.m_tiles.row_4bpp(tile_base + tile * 32, row, xflip);
+		}
 
-		const auto color = m_ppu.mem().palette.readT<Color>(PPU::palette_color_offset(depth ? 0 : palette, dot_color));
-		m_ppu.colorbuffer_write_bg(i - scx, dot_color, priority, color);
+		const uint16 palette_base = PPU::palette_index(depth ? 0 : text_data.m_struct.palette_number, 0);
+		for(unsigned i = 0; i < 8; ++i) {
+			const int dot_x = screen_x + static_cast<int>(i);
+			if(dot_x < 0 || dot_x >= 240 || dots[i] == 0) {
+				continue;
+			}
+			m_ppu.colorbuffer_write_bg(dot_x, dots[i], priority, palette_base + dots[i]);
+		}
 	}
 }
 
@@ -85,66 +73,143 @@ void Backgrounds::draw_mode0() {
 	draw_textmode<3>();
 }
 
+/*
+ *  Affine backgrounds always use 8bpp tiles and one byte per map entry. The
+ *  texture coordinates are stepped across the line eight dots at a time, with
+ *  the wraparound and the transparent area outside of the map applied as
+ *  masks, so the only work per dot are the map and tile lookups.
+ */
+template<unsigned n>
+void Backgrounds::draw_affine() {
+	static_assert(n == 2 || n == 3, "Only BG2 and BG3 can be affine");
+	auto const& bg = m_ppu.m_line.bg[n];
+	auto const& affine = m_ppu.m_line.affine[n - 2];
+	auto& ref = m_affine[n - 2];
+
+	if(m_ppu.m_line.vcount == 0 || ref.reload_x) {
+		ref.x = affine.refx;
+		ref.reload_x = false;
+	}
+	if(m_ppu.m_line.vcount == 0 || ref.reload_y) {
+		ref.y = affine.refy;
+		ref.reload_y = false;
+	}
+
+	const int32 pa = affine.pa;
+	const int32 pb = affine.pb;
+	const int32 pc = affine.pc;
+	const int32 pd = affine.pd;
+
+	if(bg_enabled<n>()) {
+		const uint32 screen_base = bg.control.base_screen_block * 2 * kB;
+		const uint32 tile_base = bg.control.base_tile_block * 16 * kB;
+		const uint8 priority = bg.control.priority;
+		const uint32 size = 128u << bg.control.screen_size;
+		const uint32 size_mask = size - 1;
+		const unsigned tiles_per_row = size / 8;
+		const uint8 wrap = bg.control.area_overflow ? 1 : 0;
+
+		auto& vram = *m_ppu.m_video.vram;
+
+		int32 line_x = ref.x;
+		int32 line_y = ref.y;
+		for(unsigned screen_x = 0; screen_x < 240; screen_x += 8) {
+			uint32 tx[8];
+			uint32 ty[8];
+			uint8 visible[8];
+			for(unsigned i = 0; i < 8; ++i) {
+				const int32 x = (line_x + pa * static_cast<int32>(i)) >> 8;
+				const int32 y = (line_y + pc * static_cast<int32>(i)) >> 8;
+				const uint8 inside = (static_cast<uint32>(x) < size) & (static_cast<uint32>(y) < size);
+				visible[i] = wrap | inside;
+				tx[i] = static_cast<uint32>(x) & size_mask;
+				ty[i] = static_cast<uint32>(y) & size_mask;
+			}
+			line_x += 8 * pa;
+			line_y += 8 * pc;
+
+			for(unsigned i = 0; i < 8; ++i) {
+				const uint8 tile = vram.readT<uint8>(screen_base + (ty[i] >> 3u) * tiles_per_row + (tx[i] >> 3u));
+				const uint8 dot = vram.readT<uint8>(tile_base + tile * 64 + (ty[i] & 7u) * 8 + (tx[i] & 7u));
+				//  Dots outside of a non-wrapping map are transparent
+				const uint8 color_number = dot & -visible[i];
+				m_ppu.colorbuffer_write_bg(screen_x + i, color_number, priority, PPU::palette_index(0, color_number));
+			}
+		}
+	}
+
+	ref.x += pb;
+	ref.y += pd;
+}
+
 void Backgrounds::draw_mode1() {
-	//	ASSERT_NOT_REACHED();
+	draw_textmode<0>();
+	draw_textmode<1>();
+	draw_affine<2>();
 }
 
 void Backgrounds::draw_mode2() {
-	//	ASSERT_NOT_REACHED();
+	draw_affine<2>();
+	draw_affine<3>();
 }
 
 void Backgrounds::draw_mode3() {
-	const auto& ctl = m_ppu.io().dispcnt;
+	const auto& ctl = m_ppu.m_line.dispcnt;
 
-	if(ctl->BG2) {
-		const auto ly = *m_ppu.io().vcount;
+	if(ctl.BG2) {
+		const auto ly = m_ppu.m_line.vcount;
 		const auto line_offset = ly * 480;//  480 bytes per line
 
 		for(unsigned x = 0; x < 240; ++x) {
-			const auto& color = (Color)m_ppu.mem().vram.read16(line_offset + x * 2);
-			m_ppu.colorbuffer_write_bg(x, 1, 0, color);
+			const auto& color = (Color)m_ppu.m_video.vram->read16(line_offset + x * 2);
+			m_ppu.colorbuffer_write_bg_direct(x, 0, color);
 		}
 	}
 }
 
 void Backgrounds::draw_mode4() {
-	const auto& ctl = m_ppu.io().dispcnt;
+	const auto& ctl = m_ppu.m_line.dispcnt;
 
-	if(ctl->BG2) {
-		const auto ly = *m_ppu.io().vcount;
-		const auto frame_offset = (ctl->frame_select ? 0xA000 : 0);
+	if(ctl.BG2) {
+		const auto ly = m_ppu.m_line.vcount;
+		const auto frame_offset = (ctl.frame_select ? 0xA000 : 0);
 
 		for(unsigned i = 0; i < 240; ++i) {
 			const auto line_offset = ly * 240;
-			const auto pixel = m_ppu.mem().vram.read8(frame_offset + line_offset + i);
-			const auto color = m_ppu.mem().palette.readT<Color>(PPU::palette_color_offset(0, pixel));
+			const auto pixel = m_ppu.m_video.vram->read8(frame_offset + line_offset + i);
 
-			m_ppu.colorbuffer_write_bg(i, 1, 0, color);
+			m_ppu.colorbuffer_write_bg(i, 1, 0, PPU::palette_index(0, pixel));
 		}
 	}
 }
 
 void Backgrounds::draw_mode5() {
-	const auto& ctl = m_ppu.io().dispcnt;
+	const auto& ctl = m_ppu.m_line.dispcnt;
 
-	if(ctl->BG2) {
-		const auto ly = *m_ppu.io().vcount;
-		const auto frame_offset = (ctl->frame_select ? 0xA000 : 0);
+	if(ctl.BG2) {
+		const auto ly = m_ppu.m_line.vcount;
+		const auto frame_offset = (ctl.frame_select ? 0xA000 : 0);
 
 		for(unsigned i = 0; i < 240; ++i) {
 			const auto line_offset = ly * 240;
-			const auto pixel = m_ppu.mem().vram.read8(frame_offset + line_offset + i);
-			const auto color = m_ppu.mem().palette.readT<Color>(PPU::palette_color_offset(0, pixel));
+			const auto pixel = m_ppu.m_video.vram->read8(frame_offset + line_offset + i);
 
-			m_ppu.colorbuffer_write_bg(i, 1, 0, color);
+			m_ppu.colorbuffer_write_bg(i, 1, 0, PPU::palette_index(0, pixel));
 		}
 	}
 }
 
 void Backgrounds::draw_scanline() {
-	const auto& ctl = m_ppu.io().dispcnt;
+	const auto& ctl = m_ppu.m_line.dispcnt;
+
+	//  Reference points written on lines without affine backgrounds are
+	//  latched once the background is drawn again
+	for(unsigned i = 0; i < 2; ++i) {
+		m_affine[i].reload_x |= m_ppu.m_line.affine[i].reload_x;
+		m_affine[i].reload_y |= m_ppu.m_line.affine[i].reload_y;
+	}
 
-	switch(ctl->video_mode) {
+	switch(ctl.video_mode) {
 		case 0: draw_mode0(); break;
 		case 1: draw_mode1(); break;
 		case 2: draw_mode2(); break;
@@ -161,11 +226,11 @@ void Backgrounds::draw_scanline() {
 template<unsigned int n>
 constexpr bool Backgrounds::bg_enabled() {
 	if constexpr(n == 0)
-		return m_ppu.io().dispcnt->BG0;
+		return m_ppu.m_line.dispcnt.BG0;
 	else if constexpr(n == 1)
-		return m_ppu.io().dispcnt->BG1;
+		return m_ppu.m_line.dispcnt.BG1;
 	else if constexpr(n == 2)
-		return m_ppu.io().dispcnt->BG2;
+		return m_ppu.m_line.dispcnt.BG2;
 	else
-		return m_ppu.io().dispcnt->BG3;
+		return m_ppu.m_line.dispcnt.BG3;
 }
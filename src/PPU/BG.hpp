@@ -3,7 +3,17 @@
 
 class PPU;
 class Backgrounds {
+	//  Internal reference points of BG2 and BG3, latched from the registers
+	struct AffineRef {
+		int32 x;
+		int32 y;
+		//  Registers written on a line that did not draw the background yet
+		bool reload_x;
+		bool reload_y;
+	};
+
 	PPU& m_ppu;
+	AffineRef m_affine[2] {};
 
 	template<unsigned n>
 	constexpr bool bg_enabled();
@@ -11,6 +21,9 @@ class Backgrounds {
 	template<unsigned n>
 	void draw_textmode();
 
+	template<unsigned n>
+	void draw_affine();
+
 	void draw_mode0();
 	void draw_mode1();
 	void draw_mode2();
@@ -18,8 +31,6 @@ class Backgrounds {
 	void draw_mode4();
 	void draw_mode5();
 
-	template<unsigned n>
-	constexpr BG<n>& current_bg();
 public:
 	Backgrounds(PPU& v)
 	    : m_ppu(v) {}
@@ -1,10 +1,24 @@
 #include "PPU/PPU.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iterator>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "Bus/Common/MemoryLayout.hpp"
 #include "CPU/ARM7TDMI.hpp"
+#include "Emulator/Config.hpp"
+#include "Emulator/Scheduler.hpp"
+#include "PPU/RenderThread.hpp"
 
 PPU::PPU(GaBber& emu)
     : Module(emu)
-    , m_backgrounds(*this) {}
+    , m_backgrounds(*this)
+    , m_tiles(*this)
+    , m_video { &mem().vram, &mem().palette, &mem().oam, m_framebuffer } {}
+
+PPU::~PPU() = default;
 
 bool PPU::is_HBlank() const {
 	return io().dispstat->HBlank && vcount() >= 160;
@@ -14,11 +28,7 @@ bool PPU::is_VBlank() const {
 	return vcount() >= 160 && vcount() <= 227;
 }
 
-static unsigned global_cycles { 0 };
-static unsigned current_scanline_position { 0 };
-
 void PPU::next_scanline() {
-	current_scanline_position = 0;
 	vcount()++;
 
 	if(vcount() == io().dispstat->LYC) {
@@ -38,6 +48,9 @@ void PPU::next_scanline() {
 		if(io().dispstat->VBlank_IRQ) {
 			cpu().raise_irq(IRQType::VBlank);
 		}
+		if(m_render_thread) {
+			m_render_thread->finish_frame(m_framebuffer);
+		}
 		m_frame_ready = true;
 	} else if(vcount() == 228) {
 		io().dispstat->VBlank = false;
@@ -45,39 +58,101 @@ void PPU::next_scanline() {
 	}
 }
 
-void PPU::cycle() {
-	global_cycles++;
+void PPU::schedule_events(uint64 line_start) {
+	scheduler().schedule_at(EventType::PPUHBlank, line_start + cycles_per_hdraw);
+	scheduler().schedule_at(EventType::PPUScanline, line_start + cycles_per_scanline);
+}
 
-	static unsigned pixel_cycles { 0 };
-	if(++pixel_cycles != 4)
+void PPU::on_hblank() {
+	if(is_VBlank()) {
 		return;
+	}
 
-	pixel_cycles = 0;
-	current_scanline_position++;
+	io().dispstat->HBlank = true;
+	cpu().dma_start_hblank();
+	if(io().dispstat->HBlank_IRQ) {
+		cpu().raise_irq(IRQType::HBlank);
+	}
 
-	if(current_scanline_position == 240 && !is_VBlank()) {
-		io().dispstat->HBlank = true;
-		cpu().dma_start_hblank();
-		if(io().dispstat->HBlank_IRQ) {
-			cpu().raise_irq(IRQType::HBlank);
-		}
+	if(vcount() == 0) {
+		update_render_mode();
+	}
 
-		draw_scanline();
-	} else if(current_scanline_position == 308) {
-		next_scanline();
+	const auto registers = capture_line_registers();
+	if(m_render_thread) {
+		m_render_thread->submit(registers);
+	} else {
+		draw_scanline(registers);
 	}
 }
 
-void PPU::draw_scanline() {
-	if(io().dispcnt->forced_blank) {
+void PPU::on_scanline_end(uint64 timestamp) {
+	next_scanline();
+	schedule_events(timestamp);
+}
+
+PPU::LineRegisters PPU::capture_line_registers() {
+	const auto capture_background = [](auto const& bg) {
+		return LineRegisters::Background { *bg.m_control.template as<BGxCNTReg>(), *bg.m_xoffset, *bg.m_yoffset };
+	};
+	//  Writes to the reference points are handed over to the renderer
+	const auto capture_affine = [](auto& bg) {
+		const LineRegisters::Affine affine {
+			.pa = static_cast<int16>(*bg.m_dx),
+			.pb = static_cast<int16>(*bg.m_dmx),
+			.pc = static_cast<int16>(*bg.m_dy),
+			.pd = static_cast<int16>(*bg.m_dmy),
+			.refx = bg.m_refx.value(),
+			.refy = bg.m_refy.value(),
+			.reload_x = bg.m_refx.m_reload,
+			.reload_y = bg.m_refy.m_reload,
+		};
+		bg.m_refx.m_reload = false;
+		bg.m_refy.m_reload = false;
+		return affine;
+	};
+
+	LineRegisters registers {};
+	registers.vcount = vcount();
+	registers.dispcnt = *io().dispcnt.as<DISPCNTReg>();
+	registers.bg[0] = capture_background(io().bg0);
+	registers.bg[1] = capture_background(io().bg1);
+	registers.bg[2] = capture_background(io().bg2);
+	registers.bg[3] = capture_background(io().bg3);
+	registers.affine[0] = capture_affine(io().bg2);
+	registers.affine[1] = capture_affine(io().bg3);
+	return registers;
+}
+
+/*
+ *  Starts or stops the render thread when the option changed. This is only
+ *  done at the start of a frame, after the render thread finished the
+ *  previous one.
+ */
+void PPU::update_render_mode() {
+	if(config().ppu_threaded == static_cast<bool>(m_render_thread)) {
+		return;
+	}
+
+	if(config().ppu_threaded) {
+		m_render_thread = std::make_unique<RenderThread>(*this, m_emu);
+	} else {
+		m_render_thread.reset();
+	}
+}
+
+void PPU::draw_scanline(LineRegisters const& registers) {
+	m_line = registers;
+
+	if(m_line.dispcnt.forced_blank) {
 		for(unsigned x = 0; x < 240; ++x) {
-			m_framebuffer[vcount() * 240 + x] = 0xFFFFFFFF;
+			m_video.framebuffer[m_line.vcount * 240 + x] = 0xFFFFFFFF;
 		}
 		return;
 	}
 
 	m_backgrounds.draw_scanline();
-	objects_draw_line(vcount());
+	objects_draw_line(m_line.vcount);
 	colorbuffer_blit();
 }
 
@@ -118,37 +193,28 @@ void PPU::handle_key_irq() {
 }
 
 void PPU::objects_draw_line(uint16 ly) {
-	if(!io().dispcnt->OBJ)
+	if(!m_line.dispcnt.OBJ)
 		return;
 
-	for(unsigned i = 0; i < 128; ++i) {
-		const auto obj = mem().oam.readT<OBJAttr>(PPU::obj_attr_offset(i));
-		if(!obj.contains_line(ly))
-			continue;
-		if(!obj.is_enabled())
-			continue;
-
-		objects_draw_obj(ly, obj);
+	auto& oam = *m_video.oam;
+	auto const& sprites = oam.sprites_on_line(ly);
+	for(unsigned word = 0; word < sprites.size(); ++word) {
+		for(uint64 bits = sprites[word]; bits; bits &= bits - 1) {
+			const unsigned i = word * 64 + std::countr_zero(bits);
+			objects_draw_obj(ly, oam.readT<OBJAttr>(PPU::obj_attr_offset(i)));
+		}
 	}
 }
 
 void PPU::objects_draw_obj(uint16 ly, OBJAttr obj) {
 	const auto get_obj_tile_dot = [this](uint16 tile, uint8 ly_in_tile, uint8 dot_in_tile, bool depth_flag) -> uint8 {
 		const uint32 base = 0x00010000;
-
-		const unsigned d = depth_flag ? 1 : 2;
 		const unsigned offset_to_tile = tile * 32;
-		const unsigned offset_to_dot = ly_in_tile * (8 / d) + (dot_in_tile / d);
 
-		uint8 byte = mem().vram.readT<uint8>(base + offset_to_tile + offset_to_dot);
 		if(!depth_flag) {
-			const bool is_right_pixel = (dot_in_tile % 2) != 0;
-			if(is_right_pixel)
-				byte >>= 4u;
-			byte &= 0x0Fu;
+			return m_tiles.row_4bpp(base + offset_to_tile, ly_in_tile, false)[dot_in_tile];
 		}
-
-		return byte;
+		return m_video.vram->readT<uint8>(base + offset_to_tile + ly_in_tile * 8 + dot_in_tile);
 	};
 
 	//  FIXME: Include other missed flags (mosaic...)
@@ -174,7 +240,7 @@ void PPU::objects_draw_obj(uint16 ly, OBJAttr obj) {
 	const uint8 color_depth_mult = (obj.attr0.color_mode ? 2 : 1);
 
 	uint16 base_tile = obj.attr2.tile_number;
-	if(io().dispcnt->obj_one_dim) {
+	if(m_line.dispcnt.obj_one_dim) {
 		base_tile += tile_width * which_vertical_tile * color_depth_mult;
 	} else {
 		base_tile += 32 * which_vertical_tile;
@@ -190,32 +256,54 @@ void PPU::objects_draw_obj(uint16 ly, OBJAttr obj) {
 
 		const uint8 dot = get_obj_tile_dot(tile, line_in_current_row, x, obj.attr0.color_mode);
 		const auto palette = obj.attr0.color_mode ? 0 : obj.attr2.palette_number;
-		const auto color = mem().palette.readT<Color>(PPU::obj_palette_color_offset(palette, dot));
-		colorbuffer_write_obj(obj.attr1.pos_x + i, dot, obj.attr2.priority, color);
+		colorbuffer_write_obj(obj.attr1.pos_x + i, dot, obj.attr2.priority, PPU::obj_palette_index(palette, dot));
 	}
 }
 
+/*
+ *  Covers the dots of the line with the opaque dots of the given layer.
+ */
+static void composite_layer(uint16* line, uint16 const* color, uint16 const* opaque) {
+#if defined(__SSE2__)
+	for(unsigned x = 0; x < 240; x += 8) {
+		const __m128i mask = _mm_load_si128(reinterpret_cast<__m128i const*>(opaque + x));
+		const __m128i top = _mm_load_si128(reinterpret_cast<__m128i const*>(color + x));
+		const __m128i below = _mm_load_si128(reinterpret_cast<__m128i const*>(line + x));
+		const __m128i result = _mm_or_si128(_mm_and_si128(mask, top), _mm_andnot_si128(mask, below));
+		_mm_store_si128(reinterpret_cast<__m128i*>(line + x), result);
+	}
+#else
+	for(unsigned x = 0; x < 240; ++x) {
+		line[x] = (color[x] & opaque[x]) | (line[x] & ~opaque[x]);
+	}
+#endif
+}
+
 void PPU::colorbuffer_blit() {
-	const auto backdrop = mem().palette.readT<Color>(PPU::palette_color_offset(0, 0));
+	auto const& palette = *m_video.palette;
+
+	//  Start out with the backdrop and put every layer on top, bottom layer first
+	alignas(16) uint16 line[240];
+	std::fill(std::begin(line), std::end(line), PPU::palette_index(0, 0));
+	for(int layer = layer_count - 1; layer >= 0; --layer) {
+		if(m_layers.touched[layer]) {
+			composite_layer(line, m_layers.color[layer], m_layers.opaque[layer]);
+		}
+	}
 
+	uint32* framebuffer = &m_video.framebuffer[m_line.vcount * 240];
 	for(unsigned i = 0; i < 240; ++i) {
-		Dot dot;
-		dot.dirty = false;
-		for(int priority = 7; priority >= 0; --priority) {
-			auto const& other = m_colorbuffer[priority][i];
-			if(other.dirty && other.color_number != 0) {
-				dot = other;
-			}
-		}
+		const uint16 color = line[i];
+		framebuffer[i] = (color & direct_color) ? Palette::color_to_rgba32(Color { static_cast<uint16>(color & 0x7FFFu) })
+		                                        : palette.rgba(color);
+	}
 
-		if(!dot.dirty) {
-			m_framebuffer[vcount() * 240 + i] = color_to_rgba32(backdrop);
-		} else {
-			m_framebuffer[vcount() * 240 + i] = color_to_rgba32(dot.color);
+	for(unsigned layer = 0; layer < layer_count; ++layer) {
+		if(m_layers.touched[layer]) {
+			std::memset(m_layers.opaque[layer], 0x0, sizeof(m_layers.opaque[layer]));
+			m_layers.touched[layer] = false;
 		}
 	}
-
-	std::memset(&m_colorbuffer[0], 0x0, 8 * 240 * sizeof(Dot));
 }
 
 uint16& PPU::vcount() {
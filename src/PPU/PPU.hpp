@@ -1,25 +1,92 @@
 #pragma once
 #include <fmt/format.h>
+#include <memory>
 #include "Emulator/Module.hpp"
 #include "Emulator/StdTypes.hpp"
 #include "PPU/BG.hpp"
+#include "PPU/TileCache.hpp"
 
 enum class KeypadKey;
+class Palette;
+class OAM;
+class RenderThread;
 
 class PPU : Module {
 	friend class Backgrounds;
+	friend class TileCache;
+	friend class RenderThread;
+
+	//  Every dot takes 4 cycles, HBlank starts after the 240 visible dots and
+	//  the scanline ends after 308 dots in total
+	static constexpr unsigned cycles_per_hdraw = 240 * 4;
+	static constexpr unsigned cycles_per_scanline = 308 * 4;
+
+	/*
+	 *  Line buffers of every layer, ordered from the topmost layer down. Layer
+	 *  2 * priority holds objects and layer 2 * priority + 1 backgrounds.
+	 *  Colors refer to palette entries, and are only converted to the host
+	 *  format when the line is blitted. Bitmap modes with direct colors store
+	 *  the BGR555 color with the direct_color bit set instead. Only layers
+	 *  that were touched on the current line are composited and cleared.
+	 */
+	static constexpr unsigned layer_count = 8;
+	static constexpr uint16 direct_color = 0x8000;
+	struct LayerBuffers {
+		alignas(16) uint16 color[layer_count][240];
+		//  0xFFFF for every opaque dot, 0 otherwise
+		alignas(16) uint16 opaque[layer_count][240];
+		bool touched[layer_count];
+	};
+
+	/*
+	 *  Copies of the registers the renderer reads, captured at the HBlank of
+	 *  every line. The renderer never reads the live registers, so that lines
+	 *  can be drawn after the emulation thread has moved on.
+	 */
+	struct LineRegisters {
+		struct Background {
+			BGxCNTReg control;
+			uint16 xoffset;
+			uint16 yoffset;
+		};
+		struct Affine {
+			int16 pa;
+			int16 pb;
+			int16 pc;
+			int16 pd;
+			int32 refx;
+			int32 refy;
+			//  Set if the reference point registers were written since the last line
+			bool reload_x;
+			bool reload_y;
+		};
+
+		uint16 vcount;
+		DISPCNTReg dispcnt;
+		Background bg[4];
+		Affine affine[2];
+	};
 
-	struct Dot {
-		bool dirty;
-		uint8 color_number;
-		Color color;
-		uint8 priority;
+	/*
+	 *  Memory the renderer reads from and the framebuffer it draws into. These
+	 *  are the live devices, or the copies of the render thread in threaded mode.
+	 */
+	struct VideoSources {
+		VRAM* vram;
+		Palette* palette;
+		OAM* oam;
+		uint32* framebuffer;
 	};
+
 	Backgrounds m_backgrounds;
+	TileCache m_tiles;
 
 	uint32 m_framebuffer[240 * 160];
 	bool m_frame_ready { false };
-	Dot m_colorbuffer[8][240] {};
+	LayerBuffers m_layers {};
+	LineRegisters m_line {};
+	VideoSources m_video {};
+	std::unique_ptr<RenderThread> m_render_thread;
 
 	void next_scanline();
 	bool is_HBlank() const;
@@ -33,26 +100,21 @@ class PPU : Module {
 		fmt::print("\u001b[0m\n");
 	}
 
-	static constexpr inline uint32 color_to_rgba32(Color const& color) {
-		uint32 result = (color.red << 27u) | (color.green << 19u) | (color.blue << 11u) | 0xFF;
-		return result;
-	}
-
 	static constexpr inline uint32 obj_attr_offset(uint8 obj) { return obj * 8; }
 
-	static constexpr inline uint32 palette_color_offset(uint8 palette_number, uint16 color) {
-		return palette_number * 32 + color * 2;
+	static constexpr inline uint16 palette_index(uint8 palette_number, uint16 color) {
+		return palette_number * 16 + color;
 	}
 
-	static constexpr inline uint32 obj_palette_color_offset(uint8 palette_number, uint16 color) {
-		return 0x200 + palette_number * 32 + color * 2;
+	static constexpr inline uint16 obj_palette_index(uint8 palette_number, uint16 color) {
+		return 256 + palette_number * 16 + color;
 	}
 
 	static constexpr inline uint32 bg_text_data_offset(uint32 screen_base, uint16 ly, uint16 dot) {
 		return screen_base + (ly / 8) * 0x40 + (dot / 8) * 2;
 	}
 
-	inline void colorbuffer_write_bg(uint8 x, uint8 color_number, uint8 priority, Color const& color) {
+	inline void colorbuffer_write(unsigned layer, uint8 x, uint8 color_number, uint16 color) {
 		if(x >= 240) {
 			return;
 		}
@@ -61,48 +123,43 @@ class PPU : Module {
 			return;
 		}
 
-		if(m_colorbuffer[2 * priority + 1][x].dirty) {
+		if(m_layers.opaque[layer][x]) {
 			return;
 		}
 
-		m_colorbuffer[2 * priority + 1][x] = {
-			.dirty = true,
-			.color_number = color_number,
-			.color = color,
-			.priority = priority,
-		};
+		m_layers.color[layer][x] = color;
+		m_layers.opaque[layer][x] = 0xFFFF;
+		m_layers.touched[layer] = true;
 	}
 
-	inline void colorbuffer_write_obj(uint8 x, uint8 color_number, uint8 priority, Color const& color) {
-		if(x >= 240) {
-			return;
-		}
-
-		if(color_number == 0) {
-			return;
-		}
+	inline void colorbuffer_write_bg(uint8 x, uint8 color_number, uint8 priority, uint16 palette_index) {
+		colorbuffer_write(2 * priority + 1, x, color_number, palette_index);
+	}
 
-		if(m_colorbuffer[2 * priority][x].dirty) {
-			return;
-		}
+	inline void colorbuffer_write_bg_direct(uint8 x, uint8 priority, Color const& color) {
+		colorbuffer_write(2 * priority + 1, x, 1, direct_color | (color._raw & 0x7FFFu));
+	}
 
-		m_colorbuffer[2 * priority][x] = {
-			.dirty = true,
-			.color_number = color_number,
-			.color = color,
-			.priority = priority,
-		};
+	inline void colorbuffer_write_obj(uint8 x, uint8 color_number, uint8 priority, uint16 palette_index) {
+		colorbuffer_write(2 * priority, x, color_number, palette_index);
 	}
 
 	uint16& vcount();
 	uint16 const& vcount() const;
 
+	LineRegisters capture_line_registers();
+	void update_render_mode();
+	void draw_scanline(LineRegisters const&);
+
 	void colorbuffer_blit();
 	void objects_draw_line(uint16 ly);
 	void objects_draw_obj(uint16 ly, OBJAttr obj);
 public:
 	PPU(GaBber&);
-	void cycle();
+	~PPU();
+	void schedule_events(uint64 line_start);
+	void on_hblank();
+	void on_scanline_end(uint64 timestamp);
 	bool frame_ready() const { return m_frame_ready; }
 	void clear_frame_ready() { m_frame_ready = false; }
 
@@ -111,6 +168,5 @@ public:
 	void handle_key_up(KeypadKey key);
 
 	const uint32* framebuffer() const { return m_framebuffer; }
-
-	void draw_scanline();
+	TileCache& tiles() { return m_tiles; }
 };
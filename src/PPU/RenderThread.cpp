@@ -0,0 +1,105 @@
+#include "PPU/RenderThread.hpp"
+#include <cstring>
+#include "Bus/Common/MemoryLayout.hpp"
+
+static void copy_device(BusDevice& from, BusDevice& to, uint32 size) {
+	for(uint32 offset = 0; offset < size; offset += 4) {
+		to.write32(offset, from.read32(offset));
+	}
+}
+
+RenderThread::RenderThread(PPU& ppu, GaBber& emu)
+    : m_ppu(ppu)
+    , m_vram(emu, DetachedDevice {})
+    , m_palette(emu, DetachedDevice {})
+    , m_oam(emu, DetachedDevice {}) {
+	auto& mem = m_ppu.mem();
+	copy_device(mem.vram, m_vram, 96 * kB);
+	copy_device(mem.palette, m_palette, 1 * kB);
+	copy_device(mem.oam, m_oam, 1 * kB);
+	mem.vram.set_write_log(&m_vram_writes);
+	mem.palette.set_write_log(&m_palette_writes);
+	mem.oam.set_write_log(&m_oam_writes);
+
+	//  The emulation thread does not draw while the render thread exists
+	m_ppu.m_video = { &m_vram, &m_palette, &m_oam, m_framebuffer };
+	m_thread = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+	{
+		std::lock_guard lock { m_mutex };
+		m_quit = true;
+	}
+	m_work.notify_one();
+	m_thread.join();
+
+	auto& mem = m_ppu.mem();
+	mem.vram.set_write_log(nullptr);
+	mem.palette.set_write_log(nullptr);
+	mem.oam.set_write_log(nullptr);
+	m_ppu.m_video = { &mem.vram, &mem.palette, &mem.oam, m_ppu.m_framebuffer };
+}
+
+void RenderThread::submit(PPU::LineRegisters const& registers) {
+	Line line {};
+	{
+		std::lock_guard lock { m_mutex };
+		if(!m_free.empty()) {
+			line = std::move(m_free.back());
+			m_free.pop_back();
+		}
+	}
+
+	line.registers = registers;
+	line.vram.swap(m_vram_writes);
+	line.palette.swap(m_palette_writes);
+	line.oam.swap(m_oam_writes);
+
+	{
+		std::lock_guard lock { m_mutex };
+		m_queue.push_back(std::move(line));
+		m_busy = true;
+	}
+	m_work.notify_one();
+}
+
+void RenderThread::wait_idle() {
+	std::unique_lock lock { m_mutex };
+	m_idle.wait(lock, [this] { return !m_busy; });
+}
+
+void RenderThread::finish_frame(uint32* framebuffer) {
+	wait_idle();
+	std::memcpy(framebuffer, m_framebuffer, sizeof(m_framebuffer));
+}
+
+void RenderThread::run() {
+	std::unique_lock lock { m_mutex };
+	while(true) {
+		m_work.wait(lock, [this] { return m_quit || !m_queue.empty(); });
+		if(m_queue.empty()) {
+			return;
+		}
+
+		Line line = std::move(m_queue.front());
+		m_queue.pop_front();
+		lock.unlock();
+
+		line.vram.replay(m_vram);
+		line.palette.replay(m_palette);
+		line.oam.replay(m_oam);
+		m_ppu.draw_scanline(line.registers);
+
+		line.vram.clear();
+		line.palette.clear();
+		line.oam.clear();
+
+		lock.lock();
+		m_free.push_back(std::move(line));
+		if(m_queue.empty()) {
+			m_busy = false;
+			m_idle.notify_all();
+		}
+	}
+}
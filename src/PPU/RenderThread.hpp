@@ -0,0 +1,62 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Bus/Common/WriteLog.hpp"
+#include "Bus/OAM.hpp"
+#include "Bus/Palette.hpp"
+#include "Bus/VRAM.hpp"
+#include "PPU/PPU.hpp"
+
+/*
+ *  Draws scanlines on a separate thread while the emulation thread runs
+ *  ahead. The render thread keeps its own copies of VRAM, palette and OAM,
+ *  which are brought up to date with the writes the emulation thread made
+ *  before each line. Lines are drawn into a back buffer, which is copied to
+ *  the PPU framebuffer once the frame is complete.
+ */
+class RenderThread {
+	struct Line {
+		PPU::LineRegisters registers;
+		WriteLog vram;
+		WriteLog palette;
+		WriteLog oam;
+	};
+
+	PPU& m_ppu;
+	VRAM m_vram;
+	Palette m_palette;
+	OAM m_oam;
+	uint32 m_framebuffer[240 * 160] {};
+
+	//  Writes of the emulation thread since the last submitted line
+	WriteLog m_vram_writes;
+	WriteLog m_palette_writes;
+	WriteLog m_oam_writes;
+
+	std::mutex m_mutex;
+	std::condition_variable m_work;
+	std::condition_variable m_idle;
+	std::deque<Line> m_queue;
+	//  Lines that were drawn, kept to reuse the memory of their write logs
+	std::vector<Line> m_free;
+	bool m_busy { false };
+	bool m_quit { false };
+	std::thread m_thread;
+
+	void run();
+	void wait_idle();
+public:
+	RenderThread(PPU&, GaBber&);
+	~RenderThread();
+
+	void submit(PPU::LineRegisters const&);
+
+	/*
+	 *  Waits for all submitted lines to be drawn, and copies the frame to the
+	 *  given framebuffer.
+	 */
+	void finish_frame(uint32* framebuffer);
+};
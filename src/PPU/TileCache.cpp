@@ -0,0 +1,19 @@
+#include "PPU/TileCache.hpp"
+#include "PPU/PPU.hpp"
+
+VRAM& TileCache::vram() {
+	return *m_ppu.m_video.vram;
+}
+
+void TileCache::decode(uint32 tile) {
+	auto& decoded = m_tiles[tile];
+	for(unsigned row = 0; row < 8; ++row) {
+		const uint32 data = vram().readT<uint32>(tile * VRAM::tile_bytes + row * 4);
+		for(unsigned i = 0; i < 8; ++i) {
+			const uint8 dot = (data >> (i * 4u)) & 0x0Fu;
+			decoded.rows[0][row][i] = dot;
+			decoded.rows[1][row][7 - i] = dot;
+		}
+	}
+	vram().clear_tile_dirty(tile);
+}
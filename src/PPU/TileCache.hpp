@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include "Bus/VRAM.hpp"
+#include "Emulator/StdTypes.hpp"
+
+class PPU;
+
+/*
+ *  4bpp tiles from VRAM, expanded to one palette index per byte both as
+ *  stored and mirrored horizontally. A tile is decoded again on its first use
+ *  after VRAM marked it dirty.
+ */
+class TileCache {
+	struct DecodedTile {
+		//  Indexed by horizontal flip, row and dot
+		uint8 rows[2][8][8];
+	};
+
+	PPU& m_ppu;
+	std::vector<DecodedTile> m_tiles;
+
+	void decode(uint32 tile);
+	VRAM& vram();
+public:
+	TileCache(PPU& v)
+	    : m_ppu(v)
+	    , m_tiles(VRAM::tile_count) {}
+
+	/*
+	 *  Returns the 8 dots of a row of the 4bpp tile at the given VRAM offset.
+	 */
+	uint8 const* row_4bpp(uint32 offset, unsigned row, bool xflip) {
+		const uint32 tile = VRAM::tile_index(offset);
+		if(vram().is_tile_dirty(tile)) {
+			decode(tile);
+		}
+		return m_tiles[tile].rows[xflip ? 1 : 0][row];
+	}
+};
@@ -0,0 +1,57 @@
+#include <array>
+#include <disarmv4t/arm.hpp>
+#include <random>
+#include <vector>
+#include "catch2/catch.hpp"
+
+using disarmv4t::arm::decode;
+using disarmv4t::arm::decode_fast;
+
+/*
+ *  decode_fast() must agree with decode() for every opcode. Every table index
+ *  is tried with fixed patterns in the bits outside of the index, which hit the
+ *  encodings that depend on the condition field or bits [19:8], and with random
+ *  values for all other bits.
+ */
+TEST_CASE("ARM table decoder matches the linear decoder", "[disarmv4t]") {
+	static constexpr std::array<uint32_t, 8> fills { 0x00000000, 0xf00fff0f, 0xe00fff00, 0xe00f0f00,
+		                                             0x000fff0f, 0x00000100, 0x000f0f00, 0xe1200000 };
+	std::mt19937 rng { 0x7a11e };
+
+	for(uint32_t index = 0; index < 4096; ++index) {
+		const uint32_t key = ((index & 0xff0u) << 16u) | ((index & 0xfu) << 4u);
+		for(auto fill : fills) {
+			const uint32_t opcode = key | (fill & 0xf00fff0fu);
+			REQUIRE(decode_fast(opcode) == decode(opcode));
+		}
+		for(unsigned i = 0; i < 1024; ++i) {
+			const uint32_t opcode = key | (rng() & 0xf00fff0fu);
+			REQUIRE(decode_fast(opcode) == decode(opcode));
+		}
+	}
+}
+
+TEST_CASE("ARM decoder benchmark", "[disarmv4t][!benchmark]") {
+	std::mt19937 rng { 0xbe7c };
+	std::vector<uint32_t> opcodes(4096);
+	for(auto& opcode : opcodes) {
+		//  Mostly AL conditions, like real code
+		opcode = (rng() & 0x0fffffffu) | 0xe0000000u;
+	}
+
+	BENCHMARK("decode") {
+		unsigned sum = 0;
+		for(auto opcode : opcodes) {
+			sum += static_cast<unsigned>(decode(opcode));
+		}
+		return sum;
+	};
+
+	BENCHMARK("decode_fast") {
+		unsigned sum = 0;
+		for(auto opcode : opcodes) {
+			sum += static_cast<unsigned>(decode_fast(opcode));
+		}
+		return sum;
+	};
+}
@@ -0,0 +1,116 @@
+#include <random>
+#include <vector>
+#include "Debugger/Debugger.hpp"
+#include "TestHarness.hpp"
+#include "catch2/catch.hpp"
+
+static constexpr uint32 dma3_source = 0x040000D4;
+static constexpr uint32 dma3_destination = 0x040000D8;
+static constexpr uint32 dma3_count = 0x040000DC;
+static constexpr uint32 dma3_control = 0x040000DE;
+
+//  DMAxCNT_H bits
+static constexpr uint16 dest_increment = 0u << 5u;
+static constexpr uint16 dest_decrement = 1u << 5u;
+static constexpr uint16 dest_fixed = 2u << 5u;
+static constexpr uint16 source_increment = 0u << 7u;
+static constexpr uint16 source_decrement = 1u << 7u;
+static constexpr uint16 source_fixed = 2u << 7u;
+static constexpr uint16 transfer_32bit = 1u << 10u;
+static constexpr uint16 enable = 1u << 15u;
+
+struct Transfer {
+	uint32 source;
+	uint32 destination;
+	uint16 count;
+	uint16 control;
+	//  Memory compared after the transfer
+	uint32 checked_start;
+	uint32 checked_size;
+	//  Written to the source address instead of random bytes
+	std::vector<uint8> source_data {};
+};
+
+struct TransferResult {
+	std::vector<uint8> memory;
+	unsigned cycles;
+};
+
+/*
+ *  Runs an immediate DMA3 transfer on a fresh emulator. Memory around both
+ *  ends of the transfer is filled with the same pseudo-random bytes every time.
+ *  The bulk path refuses pages with armed breakpoints, so a read breakpoint
+ *  elsewhere in the source page forces the transfer through the per-unit path.
+ */
+static TransferResult run_transfer(Transfer const& transfer, bool per_unit) {
+	TestHarness harness;
+	std::mt19937 rng { 0xd3a };
+	for(uint32 start : { transfer.source & ~0xFFFu, transfer.checked_start & ~0xFFFu }) {
+		std::vector<uint8> bytes(0x1000);
+		for(auto& byte : bytes) {
+			byte = rng();
+		}
+		harness.write(start, bytes);
+	}
+	harness.write(transfer.source, transfer.source_data);
+	if(per_unit) {
+		harness.debugger().add_breakpoint({ (transfer.source & 0xFFFF0000u) | 0xFFF0u, 4, BreakRead });
+	}
+
+	harness.bus().write32(dma3_source, transfer.source);
+	harness.bus().write32(dma3_destination, transfer.destination);
+	harness.bus().write16(dma3_count, transfer.count);
+	harness.bus().write16(dma3_control, transfer.control | enable);
+	REQUIRE(harness.dma_is_running<3>());
+
+	TransferResult result;
+	result.cycles = harness.cpu().run_next_instruction();
+	result.memory = harness.read(transfer.checked_start, transfer.checked_size);
+	REQUIRE(!harness.dma_is_running<3>());
+	return result;
+}
+
+static void compare_paths(Transfer const& transfer) {
+	const auto bulk = run_transfer(transfer, false);
+	const auto per_unit = run_transfer(transfer, true);
+	CHECK(bulk.memory == per_unit.memory);
+	CHECK(bulk.cycles == per_unit.cycles);
+}
+
+TEST_CASE("Bulk DMA transfers match per-unit transfers", "[dma]") {
+	SECTION("incrementing words, EWRAM to IWRAM") {
+		compare_paths({ 0x02000100, 0x03000200, 64, source_increment | dest_increment | transfer_32bit, 0x03000100,
+		                0x200 });
+	}
+	SECTION("incrementing halfwords, IWRAM to EWRAM") {
+		compare_paths({ 0x03000100, 0x02000202, 77, source_increment | dest_increment, 0x02000100, 0x200 });
+	}
+	SECTION("decrementing source and destination") {
+		compare_paths({ 0x02000300, 0x03000300, 32, source_decrement | dest_decrement | transfer_32bit, 0x03000200,
+		                0x200 });
+	}
+	SECTION("fixed source") {
+		compare_paths({ 0x02000100, 0x03000200, 50, source_fixed | dest_increment, 0x03000100, 0x200 });
+		compare_paths({ 0x02000102, 0x03000200, 50, source_fixed | dest_increment | transfer_32bit, 0x03000100,
+		                0x200 });
+		//  Uniform fill values take a different bulk path
+		compare_paths({ 0x02000100, 0x03000200, 50, source_fixed | dest_increment | transfer_32bit, 0x03000100,
+		                0x200, { 0x5A, 0x5A, 0x5A, 0x5A } });
+	}
+	SECTION("fixed destination") {
+		compare_paths({ 0x02000100, 0x03000200, 16, source_increment | dest_fixed | transfer_32bit, 0x03000100,
+		                0x200 });
+	}
+	SECTION("overlapping, destination after the source") {
+		compare_paths({ 0x02000100, 0x02000108, 64, source_increment | dest_increment | transfer_32bit, 0x02000000,
+		                0x400 });
+	}
+	SECTION("overlapping, destination before the source") {
+		compare_paths({ 0x02000108, 0x02000100, 64, source_increment | dest_increment, 0x02000000, 0x400 });
+	}
+	SECTION("VRAM destination") {
+		compare_paths({ 0x02000100, 0x06000200, 128, source_increment | dest_increment, 0x06000100, 0x200 });
+		compare_paths({ 0x02000100, 0x06010000, 64, source_increment | dest_increment | transfer_32bit, 0x06010000,
+		                0x100 });
+	}
+}
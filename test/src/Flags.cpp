@@ -0,0 +1,73 @@
+#include "Emulator/Bits.hpp"
+#include "TestHarness.hpp"
+#include "catch2/catch.hpp"
+
+static constexpr uint32 nzcv_mask = 0xF0000000;
+
+static constexpr uint32 operands[] { 0x00000000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF };
+
+/*
+ *  Reference implementations of the flag computations, the CSPR evaluates
+ *  them lazily.
+ */
+static uint32 eager_flags(uint32 result, bool carry, bool overflow) {
+	return (result == 0 ? (uint32)CSPR_REGISTERS::Zero : 0u) |
+	       ((result & (1u << 31u)) ? (uint32)CSPR_REGISTERS::Negative : 0u) |
+	       (carry ? (uint32)CSPR_REGISTERS::Carry : 0u) | (overflow ? (uint32)CSPR_REGISTERS::Overflow : 0u);
+}
+
+static uint32 eager_flags_add(uint32 op1, uint32 op2, uint32 C) {
+	const uint32 result = op1 + op2 + C;
+	const bool carry = ((uint64)op1 + (uint64)op2 + (uint64)C) > 0xfffffffful;
+	const bool overflow = (Bits::bit<31>(op1) == Bits::bit<31>(op2)) && (Bits::bit<31>(result) != Bits::bit<31>(op1));
+	return eager_flags(result, carry, overflow);
+}
+
+static uint32 eager_flags_sub(uint32 op1, uint32 op2, uint32 borrow) {
+	const uint32 result = op1 - op2 - borrow;
+	const bool carry = (uint64)op1 >= (uint64)op2 + (uint64)borrow;
+	const bool overflow = (Bits::bit<31>(op1) != Bits::bit<31>(op2)) && (Bits::bit<31>(result) == Bits::bit<31>(op2));
+	return eager_flags(result, carry, overflow);
+}
+
+struct Operation {
+	const char* name;
+	//  Data processing opcode field, bits 21-24
+	uint32 opcode;
+	uint32 (*expected)(uint32 op1, uint32 op2, uint32 C);
+};
+
+static constexpr Operation operations[] {
+	{ "ADD", 0b0100, [](uint32 op1, uint32 op2, uint32) { return eager_flags_add(op1, op2, 0); } },
+	{ "ADC", 0b0101, [](uint32 op1, uint32 op2, uint32 C) { return eager_flags_add(op1, op2, C); } },
+	{ "SUB", 0b0010, [](uint32 op1, uint32 op2, uint32) { return eager_flags_sub(op1, op2, 0); } },
+	{ "SBC", 0b0110, [](uint32 op1, uint32 op2, uint32 C) { return eager_flags_sub(op1, op2, C ^ 1u); } },
+	{ "RSB", 0b0011, [](uint32 op1, uint32 op2, uint32) { return eager_flags_sub(op2, op1, 0); } },
+	{ "CMP", 0b1010, [](uint32 op1, uint32 op2, uint32) { return eager_flags_sub(op1, op2, 0); } },
+};
+
+TEST_CASE("Lazily evaluated flags match the eager reference", "[alu]") {
+	TestHarness harness;
+
+	for(auto const& operation : operations) {
+		//  <op>S r0, r1, r2
+		const uint32 opcode = 0xE0100000u | (operation.opcode << 21u) | (1u << 16u) | 2u;
+		for(uint32 op1 : operands) {
+			for(uint32 op2 : operands) {
+				for(uint32 C : { 0u, 1u }) {
+					const uint32 expected = operation.expected(op1, op2, C) & nzcv_mask;
+					//  Start from the opposite N, Z and V, so that flags left untouched are caught
+					const uint32 initial = (~expected & ~(uint32)CSPR_REGISTERS::Carry & nzcv_mask) |
+					                       (C ? (uint32)CSPR_REGISTERS::Carry : 0u);
+					harness.cspr().set_flags(initial, true, false, false, false);
+					harness.reg(1) = op1;
+					harness.reg(2) = op2;
+
+					harness.execute_arm(opcode);
+					INFO(operation.name << " " << std::hex << op1 << ", " << op2 << ", C=" << C);
+					CHECK((harness.cspr().raw() & nzcv_mask) == expected);
+				}
+			}
+		}
+	}
+}
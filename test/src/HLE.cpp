@@ -0,0 +1,130 @@
+#include <vector>
+#include "TestHarness.hpp"
+#include "catch2/catch.hpp"
+
+//  SWI numbers of the BIOS calls under test
+static constexpr uint8 swi_div = 0x06;
+static constexpr uint8 swi_div_arm = 0x07;
+static constexpr uint8 swi_lz77_wram = 0x11;
+static constexpr uint8 swi_lz77_vram = 0x12;
+static constexpr uint8 swi_huff = 0x13;
+static constexpr uint8 swi_rl_wram = 0x14;
+static constexpr uint8 swi_rl_vram = 0x15;
+
+static constexpr uint32 source = 0x02000000;
+static constexpr uint32 wram_destination = 0x02001000;
+static constexpr uint32 vram_destination = 0x06000000;
+
+static void divide(TestHarness& harness, uint8 swi, uint32 r0, uint32 r1) {
+	harness.reg(0) = r0;
+	harness.reg(1) = r1;
+	harness.reg(3) = 0xDEADBEEF;
+	REQUIRE(harness.hle_swi(swi));
+}
+
+TEST_CASE("HLE Div returns quotient, remainder and absolute quotient", "[hle]") {
+	TestHarness harness;
+	harness.config().bios_hle = true;
+
+	SECTION("positive") {
+		divide(harness, swi_div, 7, 2);
+		CHECK(harness.reg(0) == 3);
+		CHECK(harness.reg(1) == 1);
+		CHECK(harness.reg(3) == 3);
+	}
+	SECTION("negative numerator") {
+		divide(harness, swi_div, static_cast<uint32>(-7), 2);
+		CHECK(harness.reg(0) == static_cast<uint32>(-3));
+		CHECK(harness.reg(1) == static_cast<uint32>(-1));
+		CHECK(harness.reg(3) == 3);
+	}
+	SECTION("negative denominator") {
+		divide(harness, swi_div, 7, static_cast<uint32>(-2));
+		CHECK(harness.reg(0) == static_cast<uint32>(-3));
+		CHECK(harness.reg(1) == 1);
+		CHECK(harness.reg(3) == 3);
+	}
+	SECTION("most negative quotient") {
+		divide(harness, swi_div, 0x80000000, static_cast<uint32>(-1));
+		CHECK(harness.reg(0) == 0x80000000);
+		CHECK(harness.reg(1) == 0);
+		CHECK(harness.reg(3) == 0x80000000);
+	}
+	SECTION("division by zero") {
+		divide(harness, swi_div, static_cast<uint32>(-5), 0);
+		CHECK(harness.reg(0) == static_cast<uint32>(-1));
+		CHECK(harness.reg(1) == static_cast<uint32>(-5));
+		CHECK(harness.reg(3) == 1);
+	}
+	SECTION("DivArm swaps the operands") {
+		divide(harness, swi_div_arm, 3, 100);
+		CHECK(harness.reg(0) == 33);
+		CHECK(harness.reg(1) == 1);
+		CHECK(harness.reg(3) == 33);
+	}
+}
+
+TEST_CASE("HLE LZ77UnComp expands literals and back references", "[hle]") {
+	TestHarness harness;
+	harness.config().bios_hle = true;
+
+	//  "ABC", then 6 bytes from 3 bytes back, then "X"
+	harness.write(source, { 0x10, 0x0A, 0x00, 0x00, 0x10, 'A', 'B', 'C', 0x30, 0x02, 'X' });
+	const std::vector<uint8> expected { 'A', 'B', 'C', 'A', 'B', 'C', 'A', 'B', 'C', 'X' };
+
+	SECTION("WRAM") {
+		harness.write(wram_destination, std::vector<uint8>(16, 0xEE));
+		harness.reg(0) = source;
+		harness.reg(1) = wram_destination;
+		REQUIRE(harness.hle_swi(swi_lz77_wram));
+		CHECK(harness.read(wram_destination, expected.size()) == expected);
+		CHECK(harness.bus().read8(wram_destination + expected.size()) == 0xEE);
+	}
+	SECTION("VRAM") {
+		harness.reg(0) = source;
+		harness.reg(1) = vram_destination;
+		REQUIRE(harness.hle_swi(swi_lz77_vram));
+		CHECK(harness.read(vram_destination, expected.size()) == expected);
+	}
+}
+
+TEST_CASE("HLE RLUnComp expands runs and literal blocks", "[hle]") {
+	TestHarness harness;
+	harness.config().bios_hle = true;
+
+	//  3 literal bytes, then a run of 5 bytes
+	harness.write(source, { 0x30, 0x08, 0x00, 0x00, 0x02, 'a', 'b', 'c', 0x82, 'z' });
+	const std::vector<uint8> expected { 'a', 'b', 'c', 'z', 'z', 'z', 'z', 'z' };
+
+	SECTION("WRAM") {
+		harness.reg(0) = source;
+		harness.reg(1) = wram_destination;
+		REQUIRE(harness.hle_swi(swi_rl_wram));
+		CHECK(harness.read(wram_destination, expected.size()) == expected);
+	}
+	SECTION("VRAM") {
+		harness.reg(0) = source;
+		harness.reg(1) = vram_destination;
+		REQUIRE(harness.hle_swi(swi_rl_vram));
+		CHECK(harness.read(vram_destination, expected.size()) == expected);
+	}
+}
+
+TEST_CASE("HLE HuffUnComp walks the tree for every code", "[hle]") {
+	TestHarness harness;
+	harness.config().bios_hle = true;
+
+	//  8-bit symbols with the codes A=0, B=10 and C=11. The root's left child
+	//  is data, its right child is a node with two data children.
+	harness.write(source, { 0x28, 0x08, 0x00, 0x00 });
+	//  Tree size, then the nodes, padded to a word
+	harness.write(source + 4, { 0x03, 0x80, 'A', 0xC0, 'B', 'C', 0x00, 0x00 });
+	//  0 10 11 0 0 11 10 10, starting from the most significant bit
+	harness.write(source + 12, { 0x00, 0x00, 0xD0, 0x59 });
+	const std::vector<uint8> expected { 'A', 'B', 'C', 'A', 'A', 'C', 'B', 'B' };
+
+	harness.reg(0) = source;
+	harness.reg(1) = wram_destination;
+	REQUIRE(harness.hle_swi(swi_huff));
+	CHECK(harness.read(wram_destination, expected.size()) == expected);
+}
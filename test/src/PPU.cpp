@@ -0,0 +1,103 @@
+#include <random>
+#include <vector>
+#include "PPU/PPU.hpp"
+#include "TestHarness.hpp"
+#include "catch2/catch.hpp"
+
+static constexpr uint32 dispcnt = 0x04000000;
+static constexpr uint32 bg0cnt = 0x04000008;
+static constexpr uint32 bg1cnt = 0x0400000A;
+static constexpr uint32 bg2cnt = 0x0400000C;
+static constexpr uint32 bg0hofs = 0x04000010;
+static constexpr uint32 bg1vofs = 0x04000016;
+static constexpr uint32 bg2pa = 0x04000020;
+static constexpr uint32 bg2pd = 0x04000026;
+static constexpr uint32 bg2x = 0x04000028;
+static constexpr uint32 bg2y = 0x0400002C;
+static constexpr uint32 palette = 0x05000000;
+static constexpr uint32 vram = 0x06000000;
+static constexpr uint32 oam = 0x07000000;
+
+//  DISPCNT bits
+static constexpr uint16 obj_one_dim = 1u << 6u;
+static constexpr uint16 bg0_enable = 1u << 8u;
+static constexpr uint16 bg1_enable = 1u << 9u;
+static constexpr uint16 bg2_enable = 1u << 10u;
+static constexpr uint16 obj_enable = 1u << 12u;
+
+static constexpr unsigned frame_count = 2;
+
+static void fill_random(TestHarness& harness, std::mt19937& rng, uint32 start, uint32 size) {
+	for(uint32 offset = 0; offset < size; offset += 4) {
+		harness.bus().write32(start + offset, rng());
+	}
+}
+
+/*
+ *  Renders frames on a fresh emulator, with the same pseudo-random memory
+ *  every time. Between lines, the palette, VRAM, OAM and the background
+ *  registers are changed, so that the render thread has to apply the writes
+ *  of every line before drawing it.
+ */
+static std::vector<uint32> render_frames(uint16 display_control, bool threaded) {
+	TestHarness harness;
+	harness.config().ppu_threaded = threaded;
+	std::mt19937 rng { 0x99a };
+
+	fill_random(harness, rng, palette, 0x400);
+	fill_random(harness, rng, vram, 0x18000);
+	fill_random(harness, rng, oam, 0x400);
+	harness.bus().write16(bg0cnt, 0x0800);
+	harness.bus().write16(bg1cnt, 0x1C81);
+	harness.bus().write16(bg2cnt, 0x4A02);
+	harness.bus().write16(bg2pa, 0x0100);
+	harness.bus().write16(bg2pd, 0x0100);
+	harness.bus().write16(dispcnt, display_control);
+
+	auto& ppu = harness.ppu();
+	std::vector<uint32> frames;
+	uint64 timestamp = 0;
+	for(unsigned frame = 0; frame < frame_count; ++frame) {
+		for(unsigned line = 0; line < 228; ++line) {
+			harness.bus().write16(bg0hofs, line * 3);
+			harness.bus().write16(bg1vofs, frame + line / 2);
+			harness.bus().write16(bg2pa, 0x0100 + line);
+			if(line % 16 == 0) {
+				harness.bus().write32(bg2x, rng() & 0x0FFFFFFF);
+				harness.bus().write32(bg2y, rng() & 0x0FFFFFFF);
+			}
+			harness.bus().write16(palette + (rng() % 0x400 & ~1u), rng());
+			harness.bus().write32(vram + (rng() % 0x18000 & ~3u), rng());
+			harness.bus().write16(oam + (rng() % 0x400 & ~1u), rng());
+
+			ppu.on_hblank();
+			timestamp += 308 * 4;
+			ppu.on_scanline_end(timestamp);
+			if(line == 159) {
+				REQUIRE(ppu.frame_ready());
+				ppu.clear_frame_ready();
+				frames.insert(frames.end(), ppu.framebuffer(), ppu.framebuffer() + 240 * 160);
+			}
+		}
+	}
+	return frames;
+}
+
+static void compare_modes(uint16 display_control) {
+	const auto inline_frames = render_frames(display_control, false);
+	const auto threaded_frames = render_frames(display_control, true);
+	REQUIRE(inline_frames.size() == threaded_frames.size());
+	CHECK(inline_frames == threaded_frames);
+}
+
+TEST_CASE("Threaded PPU draws the same frames as the inline renderer", "[ppu]") {
+	SECTION("mode 0, text backgrounds and objects") {
+		compare_modes(obj_one_dim | bg0_enable | bg1_enable | obj_enable);
+	}
+	SECTION("mode 1, affine background") {
+		compare_modes(1 | bg0_enable | bg2_enable | obj_enable);
+	}
+	SECTION("mode 3, bitmap") {
+		compare_modes(3 | bg2_enable | obj_enable);
+	}
+}
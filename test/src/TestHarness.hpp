@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include "Bus/Common/BusInterface.hpp"
+#include "CPU/ARM7TDMI.hpp"
+#include "Emulator/GaBber.hpp"
+#include "Emulator/Scheduler.hpp"
+
+/*
+ *  An emulator reset the same way as on startup, without a ROM or a BIOS
+ *  image. Tests use it to reach the internals of the CPU and the bus.
+ */
+class TestHarness {
+	GaBber m_emu;
+public:
+	TestHarness() {
+		m_emu.cpu().reset();
+		m_emu.mmu().reload();
+		m_emu.scheduler().reset();
+	}
+
+	Config& config() { return m_emu.config(); }
+	ARM7TDMI& cpu() { return m_emu.cpu(); }
+	BusInterface& bus() { return m_emu.mmu(); }
+	Debugger& debugger() { return m_emu.debugger(); }
+	PPU& ppu() { return m_emu.ppu(); }
+
+	uint32& reg(uint8 num) { return cpu().reg(num); }
+	CSPR& cspr() { return cpu().cspr(); }
+
+	void write(uint32 address, std::vector<uint8> const& bytes) {
+		for(size_t i = 0; i < bytes.size(); ++i) {
+			bus().write8(address + i, bytes[i]);
+		}
+	}
+
+	std::vector<uint8> read(uint32 address, size_t size) {
+		std::vector<uint8> bytes(size);
+		for(size_t i = 0; i < size; ++i) {
+			bytes[i] = bus().read8(address + i);
+		}
+		return bytes;
+	}
+
+	void execute_arm(uint32 opcode) { cpu().execute_ARM(opcode); }
+	bool hle_swi(uint8 number) { return cpu().hle_swi(number); }
+
+	template<unsigned x>
+	bool dma_is_running() {
+		return cpu().template dma_is_running<x>();
+	}
+};